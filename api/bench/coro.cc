@@ -0,0 +1,63 @@
+#include "stdafx.h"
+
+#include <benchmark/benchmark.h>
+
+#include "async/coro.h"
+using async::coro;
+
+namespace {
+coro<int> leaf(bool suspends) {
+  if (suspends) {
+    co_await async::suspend;
+  }
+  co_return 1;
+}
+
+coro<int> chain(int64_t depth, bool suspends) {
+  if (!depth) {
+    co_return co_await leaf(suspends);
+  }
+  co_return 1 + co_await chain(depth - 1, suspends);
+}
+
+coro<void> await_chain(int64_t depth, bool suspends, int& result) {
+  result = co_await chain(depth, suspends);
+}
+
+coro<void> create_await(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(co_await leaf(false));
+  }
+}
+
+void BM_coro_create_await(benchmark::State& state) {
+  if (!async::run_until_complete(create_await(state))) {
+    state.SkipWithError("coroutine failed");
+  }
+}
+BENCHMARK(BM_coro_create_await);
+
+// Leaf completes synchronously, so only frame creation and `co_await` of ready coroutines is
+// measured.
+void BM_await_chain_ready(benchmark::State& state) {
+  int result;
+  for (auto _ : state) {
+    async::run_until_complete(await_chain(state.range(0), false, result));
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_await_chain_ready)->RangeMultiplier(8)->Range(1, 512);
+
+// Leaf suspends once, so the whole chain is resumed level by level on completion, as it happens
+// for route -> require_auth -> db.exec -> socket_performer.
+void BM_await_chain_suspended(benchmark::State& state) {
+  int result;
+  for (auto _ : state) {
+    async::run_until_complete(await_chain(state.range(0), true, result));
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_await_chain_suspended)->RangeMultiplier(8)->Range(1, 512);
+}  // namespace
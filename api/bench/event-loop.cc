@@ -0,0 +1,110 @@
+#include "stdafx.h"
+
+#include <benchmark/benchmark.h>
+#include <sys/socket.h>
+
+#include "async/coro.h"
+#include "async/libev-event-loop.h"
+#include "async/socket.h"
+using async::coro;
+using namespace std::chrono_literals;
+
+namespace {
+coro<void> yielder(bool const& stop, int64_t& yields) {
+  while (!stop) {
+    co_await async::suspend;
+    ++yields;
+  }
+}
+
+coro<void> schedule_work(benchmark::State& state) {
+  bool stop = false;
+  int64_t yields = 0;
+  // async::run_until_complete resets the number of alive coroutines, so others are only started
+  // once it is running the loop.
+  co_await async::suspend;
+  for (int64_t i = 1; i < state.range(0); ++i) {
+    schedule_detached(yielder(stop, yields));
+  }
+
+  for (auto _ : state) {
+    co_await async::suspend;
+    ++yields;
+  }
+  stop = true;
+  state.SetItemsProcessed(yields);
+}
+
+coro<void> arm_timer(benchmark::State& state) {
+  for (auto _ : state) {
+    co_await async::sleep(1ns);
+  }
+}
+
+// Echoes every byte back until the peer closes the socket.
+coro<void> echo(async::socket_storage& storage) {
+  char c;
+  while (true) {
+    co_await async::socket_performer{async::READABLE, &storage};
+    if (read(storage.fd, &c, 1) != 1 || write(storage.fd, &c, 1) != 1) {
+      co_return;
+    }
+  }
+}
+
+coro<void> socket_round_trip(benchmark::State& state) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds)) {
+    state.SkipWithError("socketpair failed");
+    co_return;
+  }
+
+  auto loop = async::libev_event_loop::get();
+  async::socket_storage near{.fd = fds[0], .event_mask = async::READABLE};
+  async::socket_storage far{.fd = fds[1], .event_mask = async::READABLE};
+  loop->socket_add(&near);
+  loop->socket_add(&far);
+
+  auto echoer = echo(far);
+  char c = 0;
+  for (auto _ : state) {
+    if (write(near.fd, &c, 1) != 1) {
+      state.SkipWithError("write failed");
+      break;
+    }
+    co_await async::socket_performer{async::READABLE, &near};
+    if (read(near.fd, &c, 1) != 1) {
+      state.SkipWithError("read failed");
+      break;
+    }
+  }
+
+  loop->socket_del(&near);
+  close(near.fd);
+  co_await echoer;
+  loop->socket_del(&far);
+  close(far.fd);
+}
+
+// Each iteration is a single `co_await async::suspend`, that is a trip through the loop's queue.
+void BM_schedule_work(benchmark::State& state) {
+  if (!async::run_until_complete(schedule_work(state))) {
+    state.SkipWithError("coroutine failed");
+  }
+}
+BENCHMARK(BM_schedule_work)->RangeMultiplier(8)->Range(1, 512);
+
+void BM_sleep_arm_timer(benchmark::State& state) {
+  if (!async::run_until_complete(arm_timer(state))) {
+    state.SkipWithError("coroutine failed");
+  }
+}
+BENCHMARK(BM_sleep_arm_timer);
+
+void BM_socket_performer_round_trip(benchmark::State& state) {
+  if (!async::run_until_complete(socket_round_trip(state))) {
+    state.SkipWithError("coroutine failed");
+  }
+}
+BENCHMARK(BM_socket_performer_round_trip);
+}  // namespace
@@ -0,0 +1,45 @@
+#include "stdafx.h"
+
+#include <benchmark/benchmark.h>
+
+#include "async/coro.h"
+#include "async/future.h"
+using async::coro, async::future;
+
+namespace {
+coro<int> await_future(future<int>& f) {
+  co_return co_await f;
+}
+
+coro<void> set_then_await(benchmark::State& state) {
+  for (auto _ : state) {
+    future<int> f;
+    f.set_result(1);
+    benchmark::DoNotOptimize(co_await f);
+  }
+}
+
+coro<void> await_then_set(benchmark::State& state) {
+  for (auto _ : state) {
+    future<int> f;
+    auto waiter = await_future(f);
+    f.set_result(1);
+    benchmark::DoNotOptimize(co_await waiter);
+  }
+}
+
+void BM_future_set_then_await(benchmark::State& state) {
+  if (!async::run_until_complete(set_then_await(state))) {
+    state.SkipWithError("coroutine failed");
+  }
+}
+BENCHMARK(BM_future_set_then_await);
+
+// Waiter is suspended by the time the result is set, so it is resumed from `set_result`.
+void BM_future_await_then_set(benchmark::State& state) {
+  if (!async::run_until_complete(await_then_set(state))) {
+    state.SkipWithError("coroutine failed");
+  }
+}
+BENCHMARK(BM_future_await_then_set);
+}  // namespace
@@ -0,0 +1,28 @@
+#include "stdafx.h"
+
+#include <benchmark/benchmark.h>
+
+#include "async/libev-event-loop.h"
+
+// Results are printed as JSON by default, so they can be compared between runtime revisions (pass
+// --benchmark_format=console to get a table instead).
+int main(int argc, char** argv) {
+  fmtlog::setThreadName("bench");
+
+  std::vector<char*> args(argv, argv + argc);
+  char json_format[] = "--benchmark_format=json";
+  args.insert(args.begin() + 1, json_format);
+  argc = int(args.size());
+  argv = args.data();
+
+  auto loop = std::make_shared<async::libev_event_loop>();
+  loop->bind_to_thread();
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  fmtlog::poll();
+}
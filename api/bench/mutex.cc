@@ -0,0 +1,48 @@
+#include "stdafx.h"
+
+#include <benchmark/benchmark.h>
+
+#include "async/coro.h"
+#include "async/mutex.h"
+using async::coro;
+
+namespace {
+coro<void> contender(async::mutex m, bool const& stop, int64_t& locks) {
+  while (!stop) {
+    co_await m.lock();
+    ++locks;
+    co_await async::suspend;
+    m.unlock();
+  }
+}
+
+coro<void> lock_unlock(benchmark::State& state) {
+  async::mutex m;
+  bool stop = false;
+  int64_t locks = 0;
+  // async::run_until_complete resets the number of alive coroutines, so others are only started
+  // once it is running the loop.
+  co_await async::suspend;
+  for (int64_t i = 1; i < state.range(0); ++i) {
+    schedule_detached(contender(m, stop, locks));
+  }
+
+  for (auto _ : state) {
+    co_await m.lock();
+    ++locks;
+    co_await async::suspend;
+    m.unlock();
+  }
+  stop = true;
+  state.SetItemsProcessed(locks);
+}
+
+// Every holder yields to the loop while holding the lock, so with more than one coroutine each
+// `lock` has to wait for the others.
+void BM_mutex_lock_unlock(benchmark::State& state) {
+  if (!async::run_until_complete(lock_unlock(state))) {
+    state.SkipWithError("coroutine failed");
+  }
+}
+BENCHMARK(BM_mutex_lock_unlock)->RangeMultiplier(4)->Range(1, 64);
+}  // namespace
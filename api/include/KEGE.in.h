@@ -27,6 +27,9 @@
 /** FCGI server socket queue size */
 inline const int FCGI_QUEUE_SIZE = 1000;
 
+/** Number of requests in progress after which worker starts handing new ones to idle workers */
+inline const int WORK_STEALING_THRESHOLD = 16;
+
 /** @cond FALSE */
 #define KEGE_VERSION_MAJOR @KEGE_VERSION_MAJOR@
 #define KEGE_VERSION_MINOR @KEGE_VERSION_MINOR@
@@ -14,19 +14,145 @@ template <typename>
 class coro;
 class suspend_t;
 
+/** Counters of the coroutine frame allocator, summed over all threads. */
+struct frame_allocator_stats {
+  /** Number of frames which were taken from the global allocator */
+  uint64_t allocated;
+
+  /** Number of frames which were served from the thread's free lists */
+  uint64_t reused;
+};
+
+frame_allocator_stats get_frame_allocator_stats();
+
+/**
+ * Awaitable which sets the task context of the awaiting coroutine.
+ *
+ * Task context is an opaque pointer which is inherited by every coroutine created while it is
+ * current and is restored whenever such a coroutine is resumed, so it follows a logical task (for
+ * example, a request) across suspensions. Pointed-to object should outlive every coroutine of the
+ * task.
+ */
+struct set_task_context {
+  void* context;
+};
+
+/** Returns the task context of the running coroutine, nullptr if there is none. */
+void* get_task_context();
+
+/**
+ * Calls @p func with no task context, so that coroutines created by it do not belong to the
+ * current task. Should be used for detached coroutines which might outlive the task.
+ */
+template <typename Func>
+auto without_task_context(Func&& func);
+
 namespace detail {
+  /** @private */
+  inline thread_local void* current_task_context = nullptr;
+
+  /**
+   * Allocates memory for a coroutine frame.
+   *
+   * Frames are grouped into size classes, each with a thread-local free list, so frames of short
+   * lived coroutines (like the ones created for every request) are reused without touching the
+   * global allocator.
+   */
+  void* allocate_frame(std::size_t size);
+
+  /** Returns memory obtained from @ref allocate_frame (possibly on another thread). */
+  void deallocate_frame(void* ptr, std::size_t size) noexcept;
+
+  /**
+   * Awaiter for the final suspension point of @ref coro.
+   *
+   * Transfers control straight to the awaiting coroutine (if any), so completion of a deep
+   * `co_await` chain neither goes through the loop's queue nor grows the native stack.
+   *
+   * @private
+   */
+  struct final_awaiter {
+    bool await_ready() noexcept {
+      return false;
+    }
+
+    void await_resume() noexcept {}
+
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+      return h.promise().final_suspend_inner(h);
+    }
+  };
+
+  /**
+   * Wraps every awaiter of @ref coro to maintain @ref current_task_context.
+   *
+   * Whoever gives control to a coroutine (by creating or resuming it) gets its own context back
+   * when the coroutine suspends or finishes, so inline resumptions do not leak contexts.
+   *
+   * @private
+   */
+  template <typename Awaitable, typename Promise>
+  struct task_context_awaiter {
+    Awaitable&& inner;
+    Promise& promise;
+    bool suspended = false;
+
+    bool await_ready() {
+      return inner.await_ready();
+    }
+
+    template <typename P>
+    auto await_suspend(std::coroutine_handle<P> h) {
+      suspended = true;
+      current_task_context = promise.outer_task_context;
+      if constexpr (std::is_same_v<decltype(inner.await_suspend(h)), bool>) {
+        if (!inner.await_suspend(h)) {
+          suspended = false;
+          current_task_context = promise.task_context;
+          return false;
+        }
+        return true;
+      } else {
+        return inner.await_suspend(h);
+      }
+    }
+
+    decltype(auto) await_resume() {
+      if (suspended) {
+        promise.outer_task_context = current_task_context;
+        current_task_context = promise.task_context;
+      }
+      return inner.await_resume();
+    }
+  };
+
   /** @private */
   struct promise_type_facade {
     std::optional<std::exception_ptr> exc;
-    std::optional<event_loop_work> parent;
+    std::coroutine_handle<> parent;
+
+    // Context of the coroutine itself and of whoever has given control to it last time
+    void* task_context = current_task_context;
+    void* outer_task_context = current_task_context;
 
     bool is_top_level : 1 = false;
     bool destroy_on_done : 1 = false;
     bool suspends_parent : 1 = false;
 
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr, std::size_t size) noexcept;
+
     std::suspend_never initial_suspend() noexcept;
-    void final_suspend_inner(std::coroutine_handle<> h) noexcept;
+    std::coroutine_handle<> final_suspend_inner(std::coroutine_handle<> h) noexcept;
     void unhandled_exception();
+
+    template <typename Awaitable>
+    task_context_awaiter<Awaitable, promise_type_facade> await_transform(Awaitable&& awaitable) {
+      return {std::forward<Awaitable>(awaitable), *this};
+    }
+
+    std::suspend_never await_transform(set_task_context c) noexcept;
   };
 }  // namespace detail
 
@@ -46,7 +172,7 @@ public:
     coro_handle handle;
 
     coro<T> get_return_object();
-    std::suspend_always final_suspend() noexcept;
+    detail::final_awaiter final_suspend() noexcept;
   };
 
   /** @private */
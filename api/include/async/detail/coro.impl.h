@@ -6,8 +6,7 @@ inline coro<T> coro<T>::base_promise_type::get_return_object() {
 }
 
 template <typename T>
-inline std::suspend_always coro<T>::base_promise_type::final_suspend() noexcept {
-  final_suspend_inner(handle);
+inline detail::final_awaiter coro<T>::base_promise_type::final_suspend() noexcept {
   return {};
 }
 
@@ -76,7 +75,7 @@ inline T coro<T>::await_resume() {
 template <typename T>
 inline void coro<T>::await_suspend(std::coroutine_handle<> h) {
   promise->suspends_parent = true;
-  promise->parent = event_loop_work(h);
+  promise->parent = h;
 }
 
 /* ==== async::detail ==== */
@@ -100,6 +99,17 @@ inline bool run_until_complete(int alive, coro<T>&& c, U... args) {
 }  // namespace detail
 
 /* ==== async ==== */
+template <typename Func>
+auto without_task_context(Func&& func) {
+  struct restorer {
+    void* saved = std::exchange(detail::current_task_context, nullptr);
+    ~restorer() {
+      detail::current_task_context = saved;
+    }
+  } guard;
+  return func();
+}
+
 template <typename... U>
 inline bool run_until_complete(coro<U>&&... args) {
   return detail::run_until_complete(0, std::forward<coro<U>>(args)...);
@@ -5,8 +5,72 @@ coro<result> connection::exec(char const* command, Params&&... params) const {
       std::index_sequence_for<Params...>{},
       std::forward<Params>(params)...,
   };
-  co_return co_await detail::exec(*conn, command, sizeof...(Params), lowered.values,
-                                  lowered.lengths, lowered.formats);
+  auto storage = conn.get();
+  if (!storage || routing != replica_routing::NONE) {
+    storage = co_await storage_for(false);
+  }
+  co_return co_await detail::exec(*storage, {command, nullptr, sizeof...(Params), lowered.values,
+                                             lowered.lengths, lowered.formats});
+}
+
+template <typename... Params, typename... Ts>
+coro<typed_result<Ts...>> connection::exec(
+    prepared_sql_query<type_sequence<std::decay_t<Params>...>, type_sequence<Ts...>> command,
+    Params&&... params) const {
+  detail::params_lowerer<sizeof...(Params)> lowered{
+      std::index_sequence_for<Params...>{},
+      std::forward<Params>(params)...,
+  };
+  auto storage = conn.get();
+  if (!storage || routing != replica_routing::NONE) {
+    storage = co_await storage_for(command.read_only);
+  }
+  result res = co_await detail::exec(*storage, {command.sql, command.name, sizeof...(Params),
+                                                lowered.values, lowered.lengths, lowered.formats});
+  co_return res.as<Ts...>();
+}
+
+template <typename... Queries>
+coro<std::tuple<typename Queries::result_type...>> connection::exec_batch(
+    Queries... queries) const {
+  detail::lowered_query lowered[] = {queries.query...};
+  auto storage = conn.get();
+  if (!storage || routing != replica_routing::NONE) {
+    storage = co_await storage_for((queries.query.read_only && ...));
+  }
+  auto results = co_await detail::exec_pipeline(*storage, lowered, sizeof...(Queries));
+  co_return [&]<size_t... Is>(std::index_sequence<Is...>) {
+    return std::tuple<typename Queries::result_type...>{Queries::get_result(results[Is])...};
+  }(std::index_sequence_for<Queries...>{});
+}
+
+template <std::ranges::input_range Rows>
+coro<std::size_t> connection::copy_from(char const* command, Rows&& rows) const {
+  auto storage = conn.get();
+  if (!storage || routing != replica_routing::NONE) {
+    storage = co_await storage_for(false);
+  }
+  auto it = std::ranges::begin(rows);
+  auto end = std::ranges::end(rows);
+  co_return co_await detail::copy(*storage, command, [&](detail::copy_encoder& out) {
+    for (; it != end && !out.is_full(); ++it) {
+      std::apply([&](auto const&... fields) { out.put_row(fields...); }, *it);
+    }
+    return it != end;
+  });
+}
+
+/* ==== async::pq ==== */
+template <typename... Params, typename... Ts>
+bound_query<Ts...> bind(
+    prepared_sql_query<type_sequence<std::decay_t<Params>...>, type_sequence<Ts...>> command,
+    Params&&... params) {
+  // Lowered parameters store pointers into themselves, so they must not be moved.
+  auto lowered = std::make_shared<detail::params_lowerer<sizeof...(Params)>>(
+      std::index_sequence_for<Params...>{}, std::forward<Params>(params)...);
+  return {{command.sql, command.name, sizeof...(Params), lowered->values, lowered->lengths,
+           lowered->formats, command.read_only},
+          lowered};
 }
 
 /* ==== async::pq::result ==== */
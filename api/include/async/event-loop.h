@@ -125,6 +125,16 @@ public:
    */
   virtual void schedule_work(event_loop_work&& work) = 0;
 
+  /**
+   * Runs @p func in the loop's thread.
+   *
+   * Unlike @ref schedule_work, this function is TS, so it is the way to pass work between loops.
+   * Functions posted to a loop which is shutting down might never be run.
+   *
+   * @param[in]  func  Function to run, should not throw
+   */
+  virtual void post(std::function<void()> func) = 0;
+
   /**
    * Handles an uncaught exception from a top-level coroutine.
    *
@@ -49,9 +49,15 @@ public:
    */
   void* get_underlying_loop();
 
+  /**
+   * Returns the number of works scheduled for execution but not yet done
+   */
+  std::size_t ready_queue_size() const;
+
   bool run(bool until_complete) override;
   void stop_notify() override;
   void schedule_work(event_loop_work&& work) override;
+  void post(std::function<void()> func) override;
   void handle_exception(std::exception_ptr const& exc) override;
 
   void register_source(std::shared_ptr<event_source> source) override;
@@ -14,6 +14,8 @@ class connection_pool;
 template <typename... Ts>
 class typed_result;
 class result;
+template <typename... Ts>
+class bound_query;
 
 using timestamp = std::chrono::system_clock::time_point;
 
@@ -21,14 +23,43 @@ class db_error : public std::runtime_error {
   using runtime_error::runtime_error;
 };
 
+// Thrown when a connection could not be acquired from the pool in time or the request was shed
+// because the pool is saturated. Requests failing with it are safe to retry later.
+class pool_exhausted_error : public db_error {
+  using db_error::db_error;
+};
+
 template <typename... Ts>
 struct type_sequence {};
 
+/**
+ * Query generated by sql-typer.
+ *
+ * It is prepared lazily on each connection under the name @ref name upon first execution. Names
+ * should be unique across the application.
+ */
 template <typename Ts, typename Params>
 struct prepared_sql_query {
   char const* sql;
+  char const* name;
+  // Marked with `--  read-only`, so it may be served by a replica (see @ref replica_routing)
+  bool read_only = false;
 };
 
+namespace detail {
+  /** @private */
+  struct lowered_query {
+    char const* command;
+    // Name of the server-side prepared statement, nullptr if the command is ad-hoc
+    char const* name;
+    int size;
+    char const* const* values;
+    int const* lengths;
+    int const* formats;
+    bool read_only = false;
+  };
+}  // namespace detail
+
 class result {
 private:
   raw_result res;
@@ -117,12 +148,78 @@ public:
   }
 };
 
+/**
+ * Query with parameters already converted to the binary format, which can be sent later as a part
+ * of a batch (see @ref connection::exec_batch). Created by @ref bind.
+ *
+ * String parameters are not copied, so they should outlive the query.
+ */
+template <typename... Ts>
+class bound_query {
+private:
+  friend connection;
+
+  template <typename... Params, typename... Us>
+  friend bound_query<Us...> bind(
+      prepared_sql_query<type_sequence<std::decay_t<Params>...>, type_sequence<Us...>> command,
+      Params&&... params);
+
+  detail::lowered_query query;
+  std::shared_ptr<void> params_owner;
+
+  bound_query(detail::lowered_query query_, std::shared_ptr<void> params_owner_)
+      : query(query_), params_owner(std::move(params_owner_)) {}
+
+public:
+  using result_type = typed_result<Ts...>;
+
+  static result_type get_result(result const& res) {
+    return res.as<Ts...>();
+  }
+};
+
+template <typename... Params, typename... Ts>
+bound_query<Ts...> bind(
+    prepared_sql_query<type_sequence<std::decay_t<Params>...>, type_sequence<Ts...>> command,
+    Params&&... params);
+
+// Waiters of higher priorities are always served first.
+enum class priority { LOW, NORMAL, HIGH };
+
+/**
+ * Which queries of a connection may be served by read replicas (see
+ * @ref connection_pool::replicas).
+ *
+ * Replicas lag behind the primary, so they should only serve reads which tolerate slightly stale
+ * data. Replicas which lag too much or cannot be reached are skipped, and if there are no others,
+ * queries silently go to the primary.
+ */
+enum class replica_routing {
+  NONE,
+  // Read-only queries generated by sql-typer go to a replica until the first other query, which
+  // pins the connection to the primary for the rest of its lifetime, so a request always reads its
+  // own writes.
+  READ_ONLY_QUERIES,
+  // Every query goes to a replica; for handlers which never write.
+  ALL,
+};
+
+struct acquire_options {
+  priority prio = priority::NORMAL;
+  // Overrides connection_pool::creation_info::acquire_timeout
+  std::optional<std::chrono::steady_clock::duration> timeout;
+  replica_routing replicas = replica_routing::NONE;
+};
+
 struct connection_storage {
   FIXED_CLASS(connection_storage)
 
   PGconn* conn;
   socket_storage sock;
 
+  // Names of statements that have been already prepared on this connection
+  std::unordered_set<std::string_view> prepared;
+
   connection_storage() {}
 
   ~connection_storage();
@@ -134,18 +231,40 @@ class connection {
   ONLY_DEFAULT_MOVABLE_CLASS(connection)
 
 private:
-  raw_connection conn;
+  // Empty until the first query if the connection is lazy
+  mutable raw_connection conn;
   connection_pool* pool;
+  acquire_options options;
   bool has_active_transaction = false;
 
+  // Connection which serves queries routed to a replica, and the pool it is taken from
+  mutable raw_connection replica_conn;
+  mutable connection_pool* replica_pool = nullptr;
+  // Drops to NONE once the connection is pinned to the primary
+  mutable replica_routing routing = replica_routing::NONE;
+
   static coro<void> rollback_and_return(raw_connection conn, connection_pool* pool);
 
+  coro<void> acquire() const;
+  coro<void> acquire_replica() const;
+  // Returns the connection which should execute the query, acquiring it if necessary.
+  coro<connection_storage*> storage_for(bool read_only) const;
+
 public:
   connection(raw_connection conn_, connection_pool* pool_);
+  // See connection_pool::get_lazy_connection
+  connection(connection_pool* pool_, acquire_options const& options_);
   ~connection();
 
+  // Returns nullptr if the connection is lazy and has not been used yet. Connections to replicas
+  // are never exposed.
   PGconn* get_raw_connection() const noexcept;
 
+  // Sends all further queries to the primary, e.g. to recheck data read from a replica before
+  // writing something based on it. Returns whether the connection has been using a replica until
+  // now. Should not be called inside of a transaction.
+  bool pin_to_primary() const;
+
   coro<void> transaction();
   coro<void> commit();
   coro<void> rollback();
@@ -156,10 +275,38 @@ public:
   template <typename... Params, typename... Ts>
   coro<typed_result<Ts...>> exec(
       prepared_sql_query<type_sequence<std::decay_t<Params>...>, type_sequence<Ts...>> command,
-      Params&&... params) const {
-    result res = co_await exec(command.sql, std::forward<Params>(params)...);
-    co_return res.as<Ts...>();
-  }
+      Params&&... params) const;
+
+  /**
+   * Executes several queries using libpq pipeline mode, so they all cost a single network round
+   * trip.
+   *
+   * If there is no active transaction, queries are executed in an implicit one, hence an error in
+   * any of them aborts the rest. The first error is rethrown after all of the results have been
+   * received.
+   *
+   * @code
+   * auto [tasks, users] = co_await db.exec_batch(pq::bind(GET_TASKS_REQUEST),
+   *                                              pq::bind(GET_USERS_REQUEST));
+   * @endcode
+   */
+  template <typename... Queries>
+  coro<std::tuple<typename Queries::result_type...>> exec_batch(Queries... queries) const;
+
+  /**
+   * Streams rows to the server with `COPY ... FROM STDIN (FORMAT binary)`, which is much cheaper
+   * than inserting them with parameters. Every row is a tuple of column values, which are encoded
+   * like query parameters; `std::nullopt` stands for NULL. Returns the number of copied rows.
+   *
+   * Rows are sent in chunks while the rest are being encoded, so the range may be lazy.
+   *
+   * @code
+   * std::vector<std::tuple<int64_t, int64_t>> rows = {{1, 2}, {3, 4}};
+   * co_await db.copy_from("COPY users_groups FROM STDIN (FORMAT binary)", rows);
+   * @endcode
+   */
+  template <std::ranges::input_range Rows>
+  coro<std::size_t> copy_from(char const* command, Rows&& rows) const;
 };
 
 class connection_pool : public event_source {
@@ -172,16 +319,38 @@ private:
   std::unique_ptr<impl> pimpl;
 
   void return_connection(raw_connection conn) noexcept;
+  coro<raw_connection> acquire(acquire_options const& options);
+
+  // Returns the least loaded of the healthy replicas, nullptr if there are none.
+  static connection_pool* pick_replica();
 
 public:
+  // Pool of the primary database
   static thread_local std::shared_ptr<connection_pool> local;
+  // Pools of read replicas, queries are routed to them according to @ref replica_routing.
+  static thread_local std::vector<std::shared_ptr<connection_pool>> replicas;
 
   using clock = std::chrono::steady_clock;
 
   struct creation_info {
     std::string_view db_path;
+    // Pool keeps `connections` open and grows up to `max_connections` while all of them are busy.
     size_t connections = 1;
+    size_t max_connections = 0;
     clock::duration creation_cooldown;
+    // Default deadline for waiting for a connection, zero means no deadline
+    clock::duration acquire_timeout{};
+    // Replica pools are added to `replicas` instead of becoming `local`. They periodically measure
+    // their replication lag and are not used while it exceeds `max_replica_lag`.
+    bool is_replica = false;
+    clock::duration max_replica_lag{};
+  };
+
+  struct stats {
+    std::size_t alive, idle, waiters;
+    // Connections established after start-up to bring the pool back to its minimal size, i.e.
+    // replacing lost or never established ones. Elastic growth is not counted.
+    std::size_t reconnects;
   };
 
   connection_pool(creation_info const& info);
@@ -192,6 +361,14 @@ public:
   void on_stop() override;
 
   coro<connection> get_connection();
+  coro<connection> get_connection(acquire_options const& options);
+
+  // Returns a connection which is only checked out from the pool upon the first query, so
+  // requests rejected before touching the database do not occupy pooled connections.
+  connection get_lazy_connection();
+  connection get_lazy_connection(acquire_options const& options);
+
+  stats get_stats() const;
 };
 
 namespace detail {
@@ -292,9 +469,73 @@ namespace detail {
     }
   };
 
+  /** @private Encodes rows in the binary format of COPY. */
+  class copy_encoder {
+  private:
+    std::string buff;
+
+    void put_int16(int16_t value);
+    void put_int32(int32_t value);
+
+    template <typename T>
+    void put_field(T const& value) {
+      auto pos = buff.size();
+      put_int32(0);
+      auto result = pq_binary_converter<T>::set(value, buff);
+      if (result) {
+        buff.append(result->begin(), result->end());
+      }
+      auto size = buff.size() - pos - 4;
+      assert(size <= std::numeric_limits<int32_t>::max());
+
+      uint32_t to_write = htobe32(static_cast<uint32_t>(size));
+      std::copy_n(reinterpret_cast<char*>(&to_write), 4, buff.begin() + std::ptrdiff_t(pos));
+    }
+
+    template <typename T>
+    void put_field(std::optional<T> const& value) {
+      if (value) {
+        put_field(*value);
+      } else {
+        put_int32(-1);
+      }
+    }
+
+  public:
+    // Encoded rows are sent once they take more than this
+    static constexpr std::size_t CHUNK_SIZE = 1 << 16;
+
+    copy_encoder();
+
+    template <typename... Ts>
+    void put_row(Ts const&... fields) {
+      put_int16(static_cast<int16_t>(sizeof...(Ts)));
+      (put_field(fields), ...);
+    }
+
+    bool is_full() const {
+      return buff.size() >= CHUNK_SIZE;
+    }
+
+    void finish();
+    // Returns the encoded data and starts a new chunk.
+    std::string take();
+  };
+
+  /** @private */
+  coro<result> exec(connection_storage& conn, lowered_query const& query);
+
+  /**
+   * @private
+   * Calls @p fill, which should encode some of the rows, until it returns false, and sends them to
+   * the server in between.
+   */
+  coro<std::size_t> copy(connection_storage& conn, char const* command,
+                         std::function<bool(copy_encoder&)> const& fill);
+
   /** @private */
-  coro<result> exec(connection_storage& conn, char const* command, int size, char const* values[],
-                    int lengths[], int formats[]);
+  coro<std::vector<result>> exec_pipeline(connection_storage& conn, lowered_query const* queries,
+                                          std::size_t count);
 }  // namespace detail
 
 #include "detail/pq.impl.h"
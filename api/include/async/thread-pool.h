@@ -0,0 +1,18 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "coro.h"
+
+namespace async {
+/**
+ * Runs `func(i)` for every `i` in [0, count) on a shared pool of background threads and resumes
+ * the caller in its own loop once all of them are done.
+ *
+ * Intended for CPU-heavy work (like hashing), which would otherwise stall every request of the
+ * loop. Indices are handed out in chunks, so `func` should be cheap enough to be called per item,
+ * and it must not touch anything bound to a loop. The first exception thrown by `func` is
+ * rethrown to the caller after the rest of the chunks have been completed or skipped.
+ */
+coro<void> parallel_for(std::size_t count, std::function<void(std::size_t)> func);
+}  // namespace async
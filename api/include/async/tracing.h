@@ -0,0 +1,63 @@
+/**
+ * Lightweight tracing of logical tasks (requests) across coroutine suspensions.
+ * @file
+ */
+#pragma once
+
+#include "stdafx.h"
+
+#include "coro.h"
+
+/**
+ * Tracing of logical tasks.
+ *
+ * A @ref trace is installed as the task context (see @ref set_task_context) of a top-level
+ * coroutine, and every @ref span opened by it or by the coroutines it creates is recorded there.
+ * If no trace is installed, spans cost a single thread-local read.
+ */
+namespace async::tracing {
+using clock = std::chrono::steady_clock;
+
+/** Timings of spans opened during a single task, kept as a tree. */
+class trace {
+private:
+  struct span_record {
+    char const* name;
+    std::string detail;
+    int parent;
+    clock::time_point start, end;
+  };
+
+  clock::time_point start = clock::now();
+  std::vector<span_record> spans;
+  int current = -1;
+
+public:
+  /** Returns the trace of the running task, nullptr if it is not traced. */
+  static trace* get();
+
+  int open(char const* name, std::string_view detail);
+  void close(int id);
+
+  /**
+   * Formats the span tree, one span per line.
+   *
+   * Concurrent coroutines of the same task share the tree, so a span is attributed to the innermost
+   * span open at the moment of its creation.
+   */
+  std::string format() const;
+};
+
+/** RAII span in the trace of the running task. Does nothing if the task is not traced. */
+class span {
+  FIXED_CLASS(span)
+
+private:
+  trace* owner;
+  int id;
+
+public:
+  span(char const* name, std::string_view detail = {});
+  ~span();
+};
+}  // namespace async::tracing
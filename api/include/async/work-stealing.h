@@ -0,0 +1,74 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "coro.h"
+#include "event-loop.h"
+
+namespace async {
+/**
+ * Distributes jobs, which have not been started yet, between several event loops.
+ *
+ * Every loop registers its own @ref work_stealing_pool::worker. A job submitted to a loop with
+ * fewer than `threshold` jobs in progress is started right away. Otherwise, it is put into the
+ * loop's queue and an idle loop (if there is one) is woken up to steal it. Loops also take jobs
+ * from their own queue (or steal from the most loaded one) whenever one of their jobs finishes.
+ *
+ * Coroutines cannot migrate between loops once started, since they hold loop-bound state (pq
+ * connections, registered sockets), so jobs are the unit of balancing. A job should thus not
+ * capture anything bound to the submitting loop.
+ *
+ * A job counts as an alive coroutine of the loop it was submitted to until it is taken, so loops
+ * do not stop while their queue is not empty.
+ */
+class work_stealing_pool : public std::enable_shared_from_this<work_stealing_pool> {
+public:
+  using job = std::function<coro<void>()>;
+
+  class worker;
+
+private:
+  struct worker_state {
+    std::mutex lock;
+    std::deque<job> queue;
+    std::atomic<std::size_t> in_progress = 0;
+    // Guarded by `lock`, set once the loop is started
+    std::shared_ptr<event_loop> loop;
+  };
+
+  std::size_t threshold;
+  std::vector<std::unique_ptr<worker_state>> workers;
+
+  static thread_local worker_state* local;
+
+  std::optional<job> take(worker_state& w);
+  coro<void> run(worker_state& w, job j);
+  void fill(worker_state& w);
+
+public:
+  /**
+   * @param[in]  workers_count  Number of loops sharing the pool
+   * @param[in]  threshold_     Number of jobs in progress after which loop is considered busy
+   */
+  work_stealing_pool(std::size_t workers_count, std::size_t threshold_);
+
+  /** Returns an event source which binds the pool to the `id`-th loop. */
+  std::shared_ptr<event_source> make_worker(std::size_t id);
+
+  /** Submits a job from the thread of a bound loop. */
+  void submit(job j);
+};
+
+/** @private */
+class work_stealing_pool::worker : public event_source {
+private:
+  std::shared_ptr<work_stealing_pool> pool;
+  worker_state* state;
+
+public:
+  worker(std::shared_ptr<work_stealing_pool> pool_, worker_state* state_);
+
+  void bind_to_thread() override;
+  void on_init() override;
+};
+}  // namespace async
@@ -13,21 +13,37 @@ struct hl_socket_address {
 struct db_info_t {
   std::string path;
   std::size_t connections;
+  // Pool of every worker grows up to this size under load, defaults to `connections`.
+  std::size_t max_connections;
   long long cooldown;
-
-  NLOHMANN_DEFINE_TYPE_INTRUSIVE(db_info_t, path, connections, cooldown)
+  // Milliseconds a request may wait for a free connection, 0 means forever.
+  long long acquire_timeout;
+  // Connection strings of read replicas. Each worker keeps a pool of the same size for every one.
+  std::vector<std::string> replicas;
+  // Replicas lagging behind by more milliseconds are not used. Sessions which have written less
+  // than that ago read from the primary.
+  long long replica_max_lag;
 };
 
 struct config_t {
   std::size_t request_workers;
   std::string api_root;
   std::string files_dir;
+  // If not empty, attachments are served by the proxy server from this internal location
+  // (X-Accel-Redirect) instead of being streamed through the FastCGI workers.
+  std::string files_accel_redirect;
   std::filesystem::path root;
   hl_socket_address fastcgi;
   db_info_t db;
+  // Whether sessions are stored in the database, so that they survive restarts.
+  bool persistent_sessions;
+  // Requests taking longer (in milliseconds) are logged with timings of their spans. Requests are
+  // not traced at all if it is 0.
+  long long slow_request_threshold;
 };
 
 void from_json(json const& j, hl_socket_address& o);
+void from_json(json const& j, db_info_t& o);
 void from_json(json const& j, config_t& o);
 config_t find_config(std::filesystem::path const& path);
 }  // namespace config
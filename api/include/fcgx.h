@@ -7,6 +7,7 @@
 
 #include "async/coro.h"
 #include "async/event-loop.h"
+#include "async/tracing.h"
 using async::coro;
 
 namespace fcgx {
@@ -50,7 +51,9 @@ enum body_type_t {
 
   BODY_PLAIN_TEXT,
   BODY_JSON,
-  BODY_FORM_URL
+  BODY_FORM_URL,
+  // application/octet-stream bodies are not read upfront, see request_t::read_body.
+  BODY_STREAM
 };
 
 class request_t {
@@ -66,6 +69,8 @@ public:
 
   body_type_t body_type = BODY_UNINITIALIZED;
   json body;
+  // Request body as is; empty for url-encoded forms since they are decoded on the fly, and for
+  // JSON bodies once they are parsed into `body`.
   std::string raw_body;
 
   std::vector<std::string> headers;
@@ -73,8 +78,34 @@ public:
   std::ostream out;
   bool is_meta_fixed = false;
 
+  // Set if the request is slow enough to be dumped, see config_t::slow_request_threshold.
+  std::unique_ptr<async::tracing::trace> trace;
+  // Set while a BODY_STREAM body is being read, during which the socket is kept non-blocking.
+  std::unique_ptr<async::socket_storage> body_socket;
+
   void fix_meta();
   void finish();
+
+  // Reads the next part of a BODY_STREAM body, returns 0 at the end of the body.
+  coro<std::size_t> read_body(char* buffer, std::size_t size);
+  // Switches the socket back to blocking mode after a BODY_STREAM body has been (partially) read.
+  void end_body_stream();
+};
+
+// Listening FastCGI socket. A single listener can be shared by servers of several workers, in
+// which case every worker accepts connections from it and whichever is the first to wake up gets
+// the connection.
+class listener {
+private:
+  int fd;
+
+public:
+  listener(config::hl_socket_address const& addr, int queue_size);
+  listener(listener const&) = delete;
+  listener& operator=(listener const&) = delete;
+  ~listener();
+
+  int get_fd() const;
 };
 
 struct server : public async::event_source {
@@ -85,6 +116,7 @@ private:
 public:
   server(config::hl_socket_address const& addr, int queue_size,
          std::function<void(FCGX_Request*)> const& handler);
+  server(std::shared_ptr<listener> socket, std::function<void(FCGX_Request*)> const& handler);
 
   void on_init() override;
   void on_stop() override;
@@ -26,6 +26,11 @@ public:
   void build(std::string_view api_root);
   route_t get_route(fcgx::request_t& r);
   void set_fallback_route(route_t route);
+
+  // Routes are numbered densely in the order of registration and the fallback route goes last, so
+  // per-route data can be kept in plain arrays. Both functions are only valid after `build`.
+  route_t get_route(fcgx::request_t& r, std::size_t& route_id);
+  std::vector<std::string> get_route_names() const;
 };
 
 class route_registrar {
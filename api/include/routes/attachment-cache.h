@@ -0,0 +1,24 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace routes {
+// Attachments are content-addressed, so metadata of a hash changes only when the attachments
+// referring to it are edited or deleted. /attachment/$hash keeps the most recently requested
+// entries in memory to avoid a database round trip for every download. The cache is shared
+// between all workers.
+namespace attachment_cache {
+  struct metadata {
+    std::string filename;
+    std::string mime_type;
+  };
+
+  // Same semantics as kim_cache::generation.
+  uint64_t generation();
+
+  std::optional<metadata> find(std::string_view hash);
+  void store(std::string_view hash, uint64_t generation, metadata m);
+
+  void invalidate(std::string_view hash);
+}  // namespace attachment_cache
+}  // namespace routes
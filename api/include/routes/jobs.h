@@ -22,4 +22,24 @@ namespace job_file_import {
 
   inline int const STATUS_LEN = sizeof(STATUS) / sizeof(char const*);
 }  // namespace job_file_import
+
+/**
+ * DB storage format:
+ * status: [numeric status:char][imported users:decimal]/[total users:decimal]
+ */
+namespace job_users_import {
+  int const DB_TYPE = 2;
+
+  enum {
+    IMPORTING = 0,
+    DONE = 1,
+    FAILED = 2,
+  };
+
+  inline char const* STATUS[] = {
+      "importing", "done", "failed",
+  };
+
+  inline int const STATUS_LEN = sizeof(STATUS) / sizeof(char const*);
+}  // namespace job_users_import
 }  // namespace routes
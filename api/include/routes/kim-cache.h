@@ -0,0 +1,34 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "contestant.pb.h"
+
+namespace routes {
+// Tasks and attachments of a KIM are the same for every contestant, so /contestant/tasks serves
+// them from memory instead of asking the database each time. The cache is shared between all
+// workers and is keyed by (kim_id, token_version).
+//
+// Snapshots are immutable once stored, hence readers can use them without holding any locks.
+namespace kim_cache {
+  struct snapshot {
+    // Only `tasks` field is populated, so it can be merged into a response directly.
+    api::ContestantKim tasks;
+    std::map<int64_t, int> task_position;
+    // Changes whenever `tasks` do, so clients can skip downloading them again.
+    std::string etag;
+  };
+
+  using snapshot_ptr = std::shared_ptr<snapshot const>;
+
+  // Should be obtained before querying the database. If any invalidation happens meanwhile,
+  // `store` will silently drop the (possibly stale) snapshot.
+  uint64_t generation();
+
+  snapshot_ptr find(int64_t kim_id, int64_t token_version);
+  void store(int64_t kim_id, int64_t token_version, uint64_t generation, snapshot_ptr s);
+
+  void invalidate(int64_t kim_id);
+  void invalidate_all();
+}  // namespace kim_cache
+}  // namespace routes
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "async/event-loop.h"
+
+namespace routes {
+// Counters of served requests and gauges of the runtime, exposed at /metrics in the Prometheus
+// text format.
+//
+// Every worker writes only into its own slot, so recording a request costs a few relaxed stores
+// and never contends with other workers. Slots are merged when metrics are scraped.
+namespace metrics {
+  // Should be called once after routes are built and before any workers are started.
+  void init(std::vector<std::string> route_names);
+
+  // Allocates the slot of the worker and periodically samples its gauges. Should be registered in
+  // every worker.
+  struct collector : public async::event_source {
+  private:
+    std::size_t worker_id;
+
+  public:
+    collector(std::size_t worker_id_);
+
+    void bind_to_thread() override;
+    void on_init() override;
+  };
+
+  // Does nothing in threads without a collector.
+  void record_request(std::size_t route_id, std::chrono::steady_clock::duration latency,
+                      bool failed);
+
+  std::string render();
+}  // namespace metrics
+}  // namespace routes
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace routes {
+// In-memory standings of a group in a KIM. Boards are built from the database once (on full
+// standings requests) and are then kept up to date by contestant answers, so standings polls do
+// not touch the database at all.
+//
+// Only the most recent submission of each (task, user) pair is stored, in the same way as
+// "Get user answers" query from standings.sql does.
+namespace scoreboard {
+  struct submission {
+    int64_t id;
+    int64_t task_id;
+    int64_t user_id;
+    double score;
+    int64_t timestamp;
+  };
+
+  struct task {
+    int64_t id;
+    int short_name;
+  };
+
+  struct user {
+    int64_t id;
+    std::string name;
+    std::vector<double> scores;
+    double total = 0;
+  };
+
+  class board {
+  private:
+    friend void on_answer(int64_t kim_id, submission const& s);
+
+    mutable std::mutex lock;
+    bool is_loaded = false;
+    // Answers which came in while the board was loading
+    std::vector<submission> pending;
+
+    std::vector<task> tasks;
+    std::map<int64_t, int> task_position;
+    std::map<int64_t, user> users;
+    std::map<std::pair<int64_t, int64_t>, submission> latest;
+    // Ids of submissions in `latest`, used to answer polls in O(delta)
+    std::map<int64_t, submission const*> by_id;
+    // Users with at least one submission, ordered by (total desc, user id)
+    std::set<std::pair<double, int64_t>, std::greater<>> ranking;
+
+    void apply(submission const& s);
+
+  public:
+    bool is_ready() const {
+      std::lock_guard guard(lock);
+      return is_loaded;
+    }
+
+    // Finishes loading the board; should be called exactly once.
+    void load(std::vector<task> tasks_, std::vector<user> users_,
+              std::vector<submission> const& submissions);
+
+    // Calls `func(tasks, users)` under the board lock.
+    template <typename Func>
+    void with_participants(Func&& func) const {
+      std::lock_guard guard(lock);
+      func(tasks, users);
+    }
+
+    // Calls `func(submission)` for submissions with id >= `min_id`; returns the maximum id of a
+    // submission on the board.
+    template <typename Func>
+    int64_t for_each_since(int64_t min_id, Func&& func) const {
+      std::lock_guard guard(lock);
+      for (auto it = by_id.lower_bound(min_id); it != by_id.end(); ++it) {
+        func(*it->second);
+      }
+      return by_id.empty() ? 0 : by_id.rbegin()->first;
+    }
+
+    // Calls `func(user)` for users with submissions in order of decreasing total score.
+    template <typename Func>
+    void for_each_ranked(Func&& func) const {
+      std::lock_guard guard(lock);
+      for (auto [total, user_id] : ranking) {
+        func(users.at(user_id));
+      }
+    }
+  };
+
+  using board_ptr = std::shared_ptr<board>;
+
+  // Returns nullptr if the board has not been built (or loaded) yet.
+  board_ptr find(int64_t kim_id, int64_t group_id);
+
+  // Registers a new empty board in place of the old one. Answers are recorded on it right away,
+  // so nothing is lost while the caller queries the database and calls `board::load`.
+  board_ptr create(int64_t kim_id, int64_t group_id);
+
+  // Unregisters a board which failed to load, unless it has been replaced already.
+  void discard(int64_t kim_id, int64_t group_id, board_ptr const& b);
+
+  // Should be called after an answer is written to the database.
+  void on_answer(int64_t kim_id, submission const& s);
+
+  // Drop boards which cannot be kept up to date by answers alone (e.g. after rejudging or editing
+  // KIMs and groups), so they are rebuilt from the database on the next request.
+  void invalidate(int64_t kim_id);
+  void invalidate_all();
+}  // namespace scoreboard
+}  // namespace routes
@@ -2,10 +2,13 @@
 
 #include "api.pb.h"
 #include "async/coro.h"
+#include "async/event-loop.h"
+#include "async/pq.h"
 #include "fcgx.h"
 
 namespace routes {
 inline constexpr auto session_logout_afk_time = std::chrono::hours(5);
+inline constexpr auto session_max_age = std::chrono::days(1);
 
 // Session might be referenced by multiple shared pointers in different workers, hence different
 // threads at the same time. We do not have locks here, so all of the fields should be either const
@@ -18,6 +21,7 @@ struct session {
 
   std::atomic<bool> logged_out = false;
   std::atomic<int64_t> last_activity = 0;
+  std::atomic<int64_t> last_write = 0;
 
   struct owned_id_range {
     const int64_t start, end;
@@ -28,8 +32,31 @@ struct session {
   std::atomic<std::shared_ptr<owned_id_range>> id_ranges;
 
   bool is_owner_of(int64_t object_id) const;
+
+  // Should be called after the session has changed anything in the database.
+  void note_write();
+  // Replicas might not have replayed recent writes of the session yet, so they are not used until
+  // conf.db.replica_max_lag passes since the last one.
+  async::pq::replica_routing routing_for_reads(async::pq::replica_routing wanted) const;
+
   api::UserInfo::initializable_type serialize() const;
   static coro<void> save(std::shared_ptr<session> s, std::string_view session_id);
+
+  // Identifier under which the session is stored in the database. Unlike session_id itself, it
+  // can be leaked without compromising the session.
+  static std::string persistent_id(std::string_view session_id);
+
+  // Loads sessions from the database into memory. Blocks, so should be called on startup before
+  // any workers are running.
+  static void restore(std::string const& db_path);
+
+  // Number of sessions currently held in memory, including the ones waiting to be reclaimed.
+  static std::size_t count();
+};
+
+// Reclaims logged out and AFK sessions in the background. Should be registered in every worker.
+struct session_gc : public async::event_source {
+  void on_init() override;
 };
 
 enum class Permission {
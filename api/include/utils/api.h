@@ -39,7 +39,9 @@ void err_nothrow(fcgx::request_t* r, api::ErrorCode code);
 template <typename T>
 T expect(fcgx::request_t* r) {
   T result;
-  if (!result.ParseFromString(r->raw_body)) {
+  // Parsed in place; sizes beyond int range are rejected by protobuf anyway.
+  if (r->raw_body.size() > INT_MAX ||
+      !result.ParseFromArray(r->raw_body.data(), (int) r->raw_body.size())) {
     err(r, api::INVALID_QUERY);
   }
   return result;
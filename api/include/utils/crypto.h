@@ -11,6 +11,22 @@ using signature_t = std::array<char, signature_length>;
 signature_t hmac_sign(std::string_view value, std::string_view key);
 std::string sha3_256(std::string_view data);
 
+// Incremental version of sha3_256 for data that does not fit in memory at once.
+class sha3_256_hasher {
+private:
+  void* context;
+
+public:
+  sha3_256_hasher();
+  sha3_256_hasher(sha3_256_hasher const&) = delete;
+  sha3_256_hasher& operator=(sha3_256_hasher const&) = delete;
+  ~sha3_256_hasher();
+
+  void update(std::string_view data);
+  // Should be called at most once.
+  std::string finish();
+};
+
 std::string urandom(int length);
 std::string urandom_priv(int length);
 }  // namespace utils
@@ -3,6 +3,8 @@
 #include "KEGE.h"
 #include "async/coro.h"
 #include "routes.h"
+#include "routes/metrics.h"
+#include "routes/session.h"
 #include "utils/api.h"
 using async::coro;
 
@@ -15,9 +17,18 @@ static coro<void> handle_status(fcgx::request_t* r) {
   co_return;
 }
 
+static coro<void> handle_metrics(fcgx::request_t* r) {
+  co_await routes::require_auth(r, routes::Permission::ADMIN);
+
+  r->mime_type = "text/plain; version=0.0.4";
+  r->fix_meta();
+  r->out << routes::metrics::render();
+}
+
 static coro<void> handle_fallback(fcgx::request_t* r) {
   utils::err(r, api::INVALID_SERVICE);
 }
 
 ROUTE_REGISTER("/status", handle_status)
+ROUTE_REGISTER("/metrics", handle_metrics)
 ROUTE_FALLBACK_REGISTER(handle_fallback)
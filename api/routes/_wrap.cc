@@ -2,16 +2,29 @@
 
 #include "async/coro.h"
 #include "async/pq.h"
+#include "async/tracing.h"
+#include "config.h"
 #include "routes.h"
+#include "routes/metrics.h"
 #include "utils/api.h"
 using async::coro;
 
 coro<void> perform_request(fcgx::request_t* r) noexcept {
+  auto start = std::chrono::steady_clock::now();
+  std::size_t route_id = SIZE_MAX;
+  bool failed = false;
+
+  if (conf.slow_request_threshold) {
+    r->trace = std::make_unique<async::tracing::trace>();
+    co_await async::set_task_context{r->trace.get()};
+  }
+
   try {
-    auto func = routes::route_storage::instance().get_route(*r);
+    auto func = routes::route_storage::instance().get_route(*r, route_id);
     if (func == 0) {
       utils::err(r, api::INTERNAL_ERROR);
     } else {
+      async::tracing::span span("dispatch", r->request_uri);
       co_await func(r);
     }
 #if KEGE_LOG_DEBUG_ENABLED
@@ -21,10 +34,28 @@ coro<void> perform_request(fcgx::request_t* r) noexcept {
 #else
   } catch (utils::expected_error const&) {
 #endif
+  } catch (async::pq::pool_exhausted_error const& e) {
+    // Database is overloaded, so the client is asked to come back instead of being failed.
+    failed = true;
+    if (!r->is_meta_fixed) {
+      r->headers.push_back("Status: 503");
+      r->headers.push_back("Retry-After: 1");
+      utils::send_raw(r, api::INTERNAL_ERROR, "");
+    }
+    logw("{} {}: {}", r->method, r->request_uri, e.what());
   } catch (...) {
+    failed = true;
     if (!r->is_meta_fixed) {
       utils::err_nothrow(r, api::INTERNAL_ERROR);
     }
     async::detail::log_top_level_exception(std::current_exception());
   }
+
+  auto latency = std::chrono::steady_clock::now() - start;
+  routes::metrics::record_request(route_id, latency, failed);
+
+  if (r->trace && latency > std::chrono::milliseconds(conf.slow_request_threshold)) {
+    logw("Slow request {} {} took {:.3f} ms:\n{}", r->method, r->request_uri,
+         std::chrono::duration<double, std::milli>(latency).count(), r->trace->format());
+  }
 }
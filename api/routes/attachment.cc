@@ -3,27 +3,73 @@
 #include "async/coro.h"
 #include "async/pq.h"
 #include "routes.h"
+#include "routes/attachment-cache.h"
 #include "routes/session.h"
 #include "utils/api.h"
 #include "utils/common.h"
 using async::coro;
 
+// Checks if any of the entity tags in If-None-Match header matches `etag` (weak comparison).
+static bool etag_matches(char const* if_none_match, std::string_view etag) {
+  if (!if_none_match) {
+    return false;
+  }
+  for (auto part_v : std::views::split(std::string_view(if_none_match), ',')) {
+    std::string_view part{part_v.begin(), part_v.end()};
+    while (part.size() && part.front() == ' ') {
+      part.remove_prefix(1);
+    }
+    while (part.size() && part.back() == ' ') {
+      part.remove_suffix(1);
+    }
+    if (part.starts_with("W/")) {
+      part.remove_prefix(2);
+    }
+    if (part == "*" || part == etag) {
+      return true;
+    }
+  }
+  return false;
+}
+
 static coro<void> handle_attachment(fcgx::request_t* r) {
   co_await routes::require_auth(r, routes::Permission::NONE);
 
   int const BUFFER_SIZE = 8192;
   char buffer[BUFFER_SIZE];
 
+  // Contents of an attachment never change, so the hash is a strong ETag.
   std::string hash = r->params["hash"], filename, mime_type;
-  {
-    auto db = co_await async::pq::connection_pool::local->get_connection();
+  std::string etag = "\"" + hash + "\"";
+
+  if (auto cached = routes::attachment_cache::find(hash)) {
+    filename = std::move(cached->filename);
+    mime_type = std::move(cached->mime_type);
+  } else {
+    auto generation = routes::attachment_cache::generation();
+    auto db = async::pq::connection_pool::local->get_lazy_connection();
     tie(filename, mime_type) =
         (co_await db.exec("SELECT filename, mime_type FROM task_attachments WHERE hash = $1 "
                           "AND NOT coalesce(deleted, false) LIMIT 1",
                           hash))
             .expect1<std::string, std::string>();
+    routes::attachment_cache::store(hash, generation, {filename, mime_type});
   }
 
+  // Checked only once the attachment is known to exist, since `*` matches current representations
+  // only (RFC 9110, 13.1.2).
+  if (etag_matches(FCGX_GetParam("HTTP_IF_NONE_MATCH", r->raw->envp), etag)) {
+    r->headers.push_back("Status: 304");
+    r->headers.push_back("ETag: " + etag);
+    r->fix_meta();
+    co_return;
+  }
+
+  // The browser does not have to revalidate at all. Responses depend on the session though, so
+  // shared caches must not store them.
+  r->headers.push_back("ETag: " + etag);
+  r->headers.push_back("Cache-Control: private, max-age=31536000, immutable");
+
   if (mime_type.starts_with("image/") || mime_type.starts_with("audio/") ||
       mime_type.starts_with("video/") || mime_type == "application/pdf" ||
       mime_type == "text/plain") {
@@ -33,6 +79,16 @@ static coro<void> handle_attachment(fcgx::request_t* r) {
                          utils::url_encode(filename));
   }
   r->mime_type = mime_type;
+
+  if (conf.files_accel_redirect.size()) {
+    // nginx keeps Content-Type, Content-Disposition and Cache-Control from this response and
+    // sends the file itself (with its own ETag, which it also revalidates by itself).
+    r->headers.push_back("X-Accel-Redirect: " + conf.files_accel_redirect + "/" +
+                         hash.substr(0, 2) + "/" + hash.substr(2));
+    r->fix_meta();
+    co_return;
+  }
+
   r->fix_meta();
 
   std::ifstream in(std::filesystem::path(conf.files_dir) / hash.substr(0, 2) / hash.substr(2),
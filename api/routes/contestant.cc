@@ -6,6 +6,8 @@
 #include "contestant.sql.cc"
 #include "routes.h"
 #include "routes/grading.h"
+#include "routes/kim-cache.h"
+#include "routes/scoreboard.h"
 #include "routes/session.h"
 #include "utils/api.h"
 #include "utils/common.h"
@@ -133,9 +135,52 @@ coro<std::vector<kim_t>> get_available_kims(async::pq::connection& db, int64_t u
   co_return kims;
 }
 
+coro<routes::kim_cache::snapshot_ptr> load_kim_snapshot(async::pq::connection& db, int64_t id,
+                                                        int64_t token_version) {
+  auto generation = routes::kim_cache::generation();
+  auto result = std::make_shared<routes::kim_cache::snapshot>();
+
+  auto [tasks, attachments] = co_await db.exec_batch(async::pq::bind(GET_KIM_TASKS_REQUEST),
+                                                     async::pq::bind(GET_KIM_ATTACHMENTS_REQUEST));
+
+  int task_pos = 0;
+  for (auto [task_id, task_type, text, answer_rows, answer_cols] : tasks) {
+    result->task_position[task_id] = task_pos++;
+
+    *result->tasks.add_tasks() = {{
+        .id = task_id,
+        .task_type = task_type,
+        .text = std::string(text),
+        .answer_rows = answer_rows,
+        .answer_cols = answer_cols,
+    }};
+  }
+
+  for (auto [task_id, filename, hash, mime_type] : attachments) {
+    auto task_it = result->task_position.find(task_id);
+    if (task_it == result->task_position.end()) {
+      // KIM was edited during contest
+      continue;
+    }
+
+    *result->tasks.mutable_tasks(task_it->second)->add_attachments() = {{
+        .filename = std::string(filename),
+        .mime_type = std::string(mime_type),
+        .hash = std::string(hash),
+    }};
+  }
+
+  auto digest = utils::sha3_256(result->tasks.SerializeAsString());
+  result->etag = utils::b16_encode(digest).substr(0, 32);
+
+  routes::kim_cache::store(id, token_version, generation, result);
+  co_return result;
+}
+
 coro<void> handle_get_available_kims(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
   auto session = co_await require_auth(r, routes::Permission::NONE);
+  auto db = async::pq::connection_pool::local->get_lazy_connection(
+      {.replicas = session->routing_for_reads(async::pq::replica_routing::ALL)});
 
   api::ContestantKimList list;
   auto current_time = std::chrono::system_clock::now();
@@ -148,14 +193,25 @@ coro<void> handle_get_available_kims(fcgx::request_t* r) {
 }
 
 coro<void> handle_get_tasks(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
   auto session = co_await require_auth(r, routes::Permission::NONE);
+  auto db = async::pq::connection_pool::local->get_lazy_connection(
+      {.replicas = session->routing_for_reads(async::pq::replica_routing::READ_ONLY_QUERIES)});
 
   auto id = utils::expect<int64_t>(r, "id");
   auto current_time = std::chrono::system_clock::now();
 
   auto kims = co_await get_available_kims(db, session->user_id, current_time);
-  auto kim = std::ranges::find_if(kims, [&](auto const& x) { return x.id == id; });
+  auto find_kim = [&] {
+    return std::ranges::find_if(kims, [&](auto const& x) { return x.id == id; });
+  };
+  auto kim = find_kim();
+
+  if (kim != kims.end() && kim->status == api::VIRTUAL_STARTABLE && db.pin_to_primary()) {
+    // Participation might have been started by another session of the user, which the replica has
+    // not replayed yet, so the primary has the final word before writing anything.
+    kims = co_await get_available_kims(db, session->user_id, current_time);
+    kim = find_kim();
+  }
 
   if (kim == kims.end()) {
     utils::err(r, api::INVALID_QUERY);
@@ -168,6 +224,7 @@ coro<void> handle_get_tasks(fcgx::request_t* r) {
     kim->virtual_end_time =
         std::min(current_time + std::chrono::milliseconds(kim->duration), kim->end_time);
     co_await db.exec(START_VIRTUAL_REQUEST);
+    session->note_write();
     kim->status = api::IN_PROGRESS;
   }
 
@@ -179,38 +236,20 @@ coro<void> handle_get_tasks(fcgx::request_t* r) {
     resp.set_write_token(std::string{reinterpret_cast<char*>(&token), sizeof(token)});
   }
 
-  // Tasks (TODO: add cache)
-  std::vector<int64_t> task_ids;
-  std::map<int64_t, int> task_position;
-
-  int task_pos = 0;
-  for (auto [task_id, task_type, text, answer_rows, answer_cols] :
-       co_await db.exec(GET_KIM_TASKS_REQUEST)) {
-    task_ids.push_back(task_id);
-    task_position[task_id] = task_pos++;
-
-    *resp.add_tasks() = {{
-        .id = task_id,
-        .task_type = task_type,
-        .text = std::string(text),
-        .answer_rows = answer_rows,
-        .answer_cols = answer_cols,
-    }};
+  // Tasks and attachments are the same for all contestants, so they are cached
+  auto tasks = routes::kim_cache::find(id, kim->token_version);
+  if (!tasks) {
+    tasks = co_await load_kim_snapshot(db, id, kim->token_version);
   }
-
-  // Attachments
-  for (auto [task_id, filename, hash, mime_type] : co_await db.exec(GET_KIM_ATTACHMENTS_REQUEST)) {
-    auto task_it = task_position.find(task_id);
-    if (task_it == task_position.end()) {
-      // KIM was edited during contest
-      continue;
+  auto const& task_position = tasks->task_position;
+  resp.set_tasks_etag(tasks->etag);
+  if (auto it = r->params.find("tasks_etag"); it != r->params.end() && it->second == tasks->etag) {
+    // Client already has the tasks, only answers are sent
+    for (auto const& task : tasks->tasks.tasks()) {
+      resp.add_tasks()->set_id(task.id());
     }
-
-    *resp.mutable_tasks(task_it->second)->add_attachments() = {{
-        .filename = std::string(filename),
-        .mime_type = std::string(mime_type),
-        .hash = std::string(hash),
-    }};
+  } else {
+    resp.MergeFrom(tasks->tasks);
   }
 
   // Most recent user answers
@@ -228,7 +267,8 @@ coro<void> handle_get_tasks(fcgx::request_t* r) {
 }
 
 coro<void> handle_answer(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
+  auto db =
+      async::pq::connection_pool::local->get_lazy_connection({.prio = async::pq::priority::HIGH});
   auto session = co_await require_auth(r, routes::Permission::NONE);
 
   auto req = utils::expect<api::ContestantAnswer>(r);
@@ -270,18 +310,29 @@ coro<void> handle_answer(fcgx::request_t* r) {
   auto [answer, grading, scale_factor] = q.expect1();
   double score = scale_factor * routes::check_and_grade(req.answer(), answer, grading);
 
-  co_await db.exec(WRITE_ANSWER_REQUEST);
+  auto [answer_id] = (co_await db.exec(WRITE_ANSWER_REQUEST)).expect1();
+  session->note_write();
+  routes::scoreboard::submission submission{
+      .id = answer_id,
+      .task_id = req.task_id(),
+      .user_id = session->user_id,
+      .score = score,
+      .timestamp = current_millis,
+  };
+  routes::scoreboard::on_answer(token.data.kim_id, submission);
 
   utils::send_raw(r, api::OK, std::string_view{reinterpret_cast<char*>(&token), sizeof(token)});
 }
 
 coro<void> handle_end_request(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
+  auto db =
+      async::pq::connection_pool::local->get_lazy_connection({.prio = async::pq::priority::HIGH});
   auto session = co_await require_auth(r, routes::Permission::NONE);
 
   auto req = utils::expect<api::ParticipationEndRequest>(r);
 
   co_await db.exec(END_PARTICIPATION_REQUEST);
+  session->note_write();
 
   utils::ok<utils::empty_payload>(r, {});
 }
@@ -1,4 +1,5 @@
 -- Available KIMs
+--  read-only
 --  nullable virtual_start_time
 --  nullable virtual_end_time
 SELECT
@@ -44,11 +45,11 @@ SELECT
     filename,
     hash,
     mime_type
-FROM
-    task_attachments
-    JOIN unnest(`task_ids`::bigint[]) AS ids ON ids = task_id
+FROM (task_attachments
+    JOIN kims_tasks USING (task_id))
 WHERE
-    shown_to_user
+    kim_id = `id`
+    AND shown_to_user
     AND NOT coalesce(deleted, FALSE);
 
 -- Start virtual
@@ -56,6 +57,7 @@ INSERT INTO users_kims
     VALUES (`session->user_id`, `kim->id`, `*kim->virtual_start_time`, `*kim->virtual_end_time`);
 
 -- Get user answers
+--  read-only
 SELECT DISTINCT ON (task_id)
     task_id,
     answer
@@ -88,7 +90,9 @@ WHERE
 
 -- Write answer
 INSERT INTO users_answers (kim_id, task_id, user_id, answer, score, submit_time)
-    VALUES (`token.data.kim_id`, `req.task_id()`, `session->user_id`, `std::string_view(req.answer())`, `score`, `current_millis`);
+    VALUES (`token.data.kim_id`, `req.task_id()`, `session->user_id`, `std::string_view(req.answer())`, `score`, `current_millis`)
+RETURNING
+    id;
 
 -- End participation
 INSERT INTO users_kims
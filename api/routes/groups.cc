@@ -12,8 +12,9 @@ using async::coro;
 
 namespace {
 coro<void> get_group_list(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
-  co_await require_auth(r, routes::Permission::ADMIN);
+  auto session = co_await require_auth(r, routes::Permission::ADMIN);
+  auto db = async::pq::connection_pool::local->get_lazy_connection(
+      {.replicas = session->routing_for_reads(async::pq::replica_routing::READ_ONLY_QUERIES)});
 
   api::GroupListResponse response;
   for (auto [id, name] : co_await db.exec(GET_GROUPS_LIST_REQUEST)) {
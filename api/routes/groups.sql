@@ -1,4 +1,5 @@
 -- Get groups list
+--  read-only
 SELECT
     *
 FROM
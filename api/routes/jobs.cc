@@ -12,7 +12,7 @@
 using async::coro;
 
 static coro<void> handle_list(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
+  auto db = async::pq::connection_pool::local->get_lazy_connection();
   co_await routes::require_auth(r, routes::Permission::ADMIN);
 
   auto q = co_await db.exec("SELECT id, type, status FROM jobs");
@@ -28,6 +28,15 @@ static coro<void> handle_list(fcgx::request_t* r) {
           .status = STATUS[std::clamp<int>(status[0], 0, STATUS_LEN - 1)],
           .open_link = "admin/job-file-import",
       };
+    } else if (type == routes::job_users_import::DB_TYPE && status.size() > 1) {
+      using namespace routes::job_users_import;
+
+      *result.add_jobs() = api::Jobs_Desc::initializable_type{
+          .id = id,
+          .desc = fmt::format("Импорт пользователей ({})", status.substr(1)),
+          .status = STATUS[std::clamp<int>(status[0], 0, STATUS_LEN - 1)],
+          .open_link = "admin/users",
+      };
     }
   }
   utils::ok(r, result);
@@ -6,6 +6,8 @@
 #include "kims.sql.cc"
 #include "routes.h"
 #include "routes/grading.h"
+#include "routes/kim-cache.h"
+#include "routes/scoreboard.h"
 #include "routes/session.h"
 #include "utils/api.h"
 #include "utils/common.h"
@@ -13,7 +15,7 @@ using async::coro;
 
 namespace {
 coro<void> handle_kim_get_editable(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
+  auto db = async::pq::connection_pool::local->get_lazy_connection();
   co_await require_auth(r, routes::Permission::ADMIN);
 
   int64_t kim_id = utils::expect<int64_t>(r, "id");
@@ -63,7 +65,7 @@ coro<void> handle_kim_get_editable(fcgx::request_t* r) {
 }
 
 coro<void> handle_kim_update(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
+  auto db = async::pq::connection_pool::local->get_lazy_connection();
   auto session = co_await require_auth(r, routes::Permission::ADMIN);
 
   auto kim = utils::expect<api::Kim>(r);
@@ -179,12 +181,16 @@ coro<void> handle_kim_update(fcgx::request_t* r) {
   }
 
   co_await db.commit();
+  session->note_write();
+  routes::kim_cache::invalidate(kim.id());
+  routes::scoreboard::invalidate(kim.id());
   utils::ok(r, utils::empty_payload{});
 }
 
 coro<void> handle_kim_list(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
-  co_await require_auth(r, routes::Permission::ADMIN);
+  auto session = co_await require_auth(r, routes::Permission::ADMIN);
+  auto db = async::pq::connection_pool::local->get_lazy_connection(
+      {.replicas = session->routing_for_reads(async::pq::replica_routing::READ_ONLY_QUERIES)});
 
   api::KimListResponse msg;
 
@@ -199,15 +205,17 @@ coro<void> handle_kim_list(fcgx::request_t* r) {
 }
 
 coro<void> revoke_access_keys(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
-  co_await require_auth(r, routes::Permission::ADMIN);
+  auto db = async::pq::connection_pool::local->get_lazy_connection();
+  auto session = co_await require_auth(r, routes::Permission::ADMIN);
   co_await db.exec(BUMP_KIM_VERSION_REQUEST);
+  session->note_write();
+  routes::kim_cache::invalidate(utils::expect<int64_t>(r, "id"));
   utils::ok(r, utils::empty_payload{});
 }
 
 coro<void> rejudge_submissions(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
-  co_await require_auth(r, routes::Permission::ADMIN);
+  auto db = async::pq::connection_pool::local->get_lazy_connection();
+  auto session = co_await require_auth(r, routes::Permission::ADMIN);
 
   int64_t kim_id = utils::expect<int64_t>(r, "id");
 
@@ -225,26 +233,32 @@ coro<void> rejudge_submissions(fcgx::request_t* r) {
 
     co_await db.exec(WRITE_REJUDGED_SCORES_REQUEST);
   }
+  session->note_write();
+  routes::scoreboard::invalidate(kim_id);
 
   utils::ok(r, utils::empty_payload{});
 }
 
 coro<void> delete_kim(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
-  co_await require_auth(r, routes::Permission::ADMIN);
+  auto db = async::pq::connection_pool::local->get_lazy_connection();
+  auto session = co_await require_auth(r, routes::Permission::ADMIN);
 
   auto req = utils::expect<api::KimDeleteRequest>(r);
   co_await db.exec(DELETE_KIM_REQUEST);
+  session->note_write();
+  routes::scoreboard::invalidate(req.id());
 
   utils::ok(r, utils::empty_payload{});
 }
 
 coro<void> clone_answers(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
-  co_await require_auth(r, routes::Permission::ADMIN);
+  auto db = async::pq::connection_pool::local->get_lazy_connection();
+  auto session = co_await require_auth(r, routes::Permission::ADMIN);
 
   auto req = utils::expect<api::CloneAnswersRequest>(r);
   co_await db.exec(CLONE_ANSWERS_REQUEST);
+  session->note_write();
+  routes::scoreboard::invalidate(req.to_id());
 
   utils::ok(r, utils::empty_payload{});
 }
@@ -27,6 +27,7 @@ WHERE
     kim_id = `kim_id`;
 
 -- Get KIM list
+--  read-only
 SELECT
     *
 FROM
@@ -3,6 +3,7 @@
 #include "async/coro.h"
 #include "async/pq.h"
 #include "routes.h"
+#include "routes/scoreboard.h"
 #include "routes/session.h"
 #include "standings.pb.h"
 #include "standings.sql.cc"
@@ -10,65 +11,84 @@
 using async::coro;
 
 namespace {
-coro<void> get_html_standings(fcgx::request_t* r) {
+// The board is kept up to date by answers submitted after its creation, so it is always loaded
+// from the primary: a lagging replica would lose the answers submitted shortly before.
+coro<routes::scoreboard::board_ptr> load_board(int64_t kim_id, int64_t group_id) {
   static constexpr int64_t min_id = 0;
 
-  auto db = co_await async::pq::connection_pool::local->get_connection();
+  auto board = routes::scoreboard::create(kim_id, group_id);
+  try {
+    auto db =
+        async::pq::connection_pool::local->get_lazy_connection({.prio = async::pq::priority::LOW});
+    auto [users, tasks, answers] = co_await db.exec_batch(
+        async::pq::bind(GET_USERS_OF_GROUP_REQUEST), async::pq::bind(GET_KIM_TASKS_REQUEST),
+        async::pq::bind(GET_USER_ANSWERS_REQUEST));
+
+    std::vector<routes::scoreboard::user> board_users;
+    for (auto [user_id, username] : users) {
+      board_users.push_back({.id = user_id, .name = std::string(username)});
+    }
+
+    std::vector<routes::scoreboard::task> board_tasks;
+    for (auto [task_id, short_name] : tasks) {
+      board_tasks.push_back({.id = task_id, .short_name = short_name});
+    }
+
+    std::vector<routes::scoreboard::submission> submissions;
+    for (auto [id, task_id, user_id, score, timestamp] : answers) {
+      submissions.push_back({id, task_id, user_id, score, timestamp});
+    }
+
+    board->load(std::move(board_tasks), std::move(board_users), submissions);
+  } catch (...) {
+    routes::scoreboard::discard(kim_id, group_id, board);
+    throw;
+  }
+  co_return board;
+}
+
+coro<routes::scoreboard::board_ptr> get_board(int64_t kim_id, int64_t group_id) {
+  if (auto board = routes::scoreboard::find(kim_id, group_id)) {
+    co_return board;
+  }
+  co_return co_await load_board(kim_id, group_id);
+}
+
+coro<void> get_html_standings(fcgx::request_t* r) {
   co_await require_auth(r, routes::Permission::ADMIN);
 
   int64_t kim_id = utils::expect<int64_t>(r, "id");
   int64_t group_id = utils::expect<int64_t>(r, "gid");
 
-  std::map<int64_t, std::pair<int, int>> tasks;
-  int pos = 0;
+  // Rebuilt like full /admin/standings requests, so edits are always visible here.
+  auto board = co_await load_board(kim_id, group_id);
 
   r->mime_type = "text/html";
   r->fix_meta();
   r->out << "<table border><thead><tr><td></td><td>Total</td>";
 
-  for (auto [task_id, short_name] : co_await db.exec(GET_KIM_TASKS_REQUEST)) {
-    tasks[task_id] = {short_name, pos++};
-    r->out << "<td>" << short_name << "</td>";
-  }
-
-  r->out << "</tr></thead><tbody>";
-
-  std::map<int64_t, std::vector<double>> ranking;
-  std::vector<int64_t> users;
-  for (auto [id, task_id, user_id, score, timestamp] : co_await db.exec(GET_USER_ANSWERS_REQUEST)) {
-    auto it = ranking.find(user_id);
-    if (it == ranking.end()) {
-      ranking[user_id] = std::vector<double>(tasks.size());
-      users.push_back(user_id);
+  board->with_participants([&](auto const& tasks, auto const&) {
+    for (auto const& task : tasks) {
+      r->out << "<td>" << task.short_name << "</td>";
     }
-    ranking[user_id][tasks[task_id].second] = score;
-  }
-
-  std::map<int64_t, std::string> usernames;
-  for (auto [user_id, username] : co_await db.exec(GET_READABLE_USERNAMES_REQUEST)) {
-    usernames[user_id] = std::string(username);
-  }
+  });
 
-  std::vector<std::tuple<double, std::string_view, std::vector<double>>> sorted;
-  for (auto user : users) {
-    double result = accumulate(ranking[user].begin(), ranking[user].end(), double(0));
-    sorted.emplace_back(result, usernames[user], ranking[user]);
-  }
-  std::ranges::sort(sorted, std::greater<>{});
+  r->out << "</tr></thead><tbody>";
 
   r->out << std::setprecision(2);
-  for (auto [score, username, score_by_task] : sorted) {
-    r->out << "<tr><td>" << username << "</td><td>" << score << "</td>";
-    for (auto curr : score_by_task) {
+  board->for_each_ranked([&](routes::scoreboard::user const& user) {
+    r->out << "<tr><td>" << user.name << "</td><td>" << user.total << "</td>";
+    for (auto curr : user.scores) {
       r->out << "<td>" << curr << "</td>";
     }
     r->out << "</tr>";
-  }
+  });
   r->out << "</tbody></table>";
 }
 
+// Served from the in-memory scoreboard. Full requests (sync_tag = 0) rebuild the board from the
+// database, so edits of groups and KIMs become visible after reloading standings.
 coro<void> get_standings(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
   co_await require_auth(r, routes::Permission::ADMIN);
 
   auto request = utils::expect<api::StandingsRequest>(r);
@@ -78,46 +98,49 @@ coro<void> get_standings(fcgx::request_t* r) {
   api::StandingsResponse resp;
   int64_t min_id = request.sync_tag();
 
-  if (!min_id) {
-    for (auto [user_id, username] : co_await db.exec(GET_USERS_OF_GROUP_REQUEST)) {
-      *resp.add_users() = {{
-          .id = user_id,
-          .name = std::string(username),
-      }};
-    }
+  auto board = co_await (min_id ? get_board(kim_id, group_id) : load_board(kim_id, group_id));
 
-    for (auto [task_id, short_name] : co_await db.exec(GET_KIM_TASKS_REQUEST)) {
-      *resp.add_tasks() = {{
-          .id = task_id,
-          // FIXME: Better naming of repetitive short_names
-          .name = std::to_string(short_name),
-      }};
-    }
+  if (!min_id) {
+    board->with_participants([&](auto const& tasks, auto const& users) {
+      for (auto const& [user_id, user] : users) {
+        *resp.add_users() = {{
+            .id = user_id,
+            .name = user.name,
+        }};
+      }
+
+      for (auto const& task : tasks) {
+        *resp.add_tasks() = {{
+            .id = task.id,
+            // FIXME: Better naming of repetitive short_names
+            .name = std::to_string(task.short_name),
+        }};
+      }
+    });
   }
 
-  auto max_id = std::max<int64_t>(1, min_id - 1);
-  for (auto [id, task_id, user_id, score, timestamp] : co_await db.exec(GET_USER_ANSWERS_REQUEST)) {
-    max_id = std::max(max_id, id);
+  auto max_id = board->for_each_since(min_id, [&](routes::scoreboard::submission const& s) {
     *resp.add_submissions() = {{
-        .user_id = user_id,
-        .task_id = task_id,
-        .score = score,
-        .timestamp = timestamp,
+        .user_id = s.user_id,
+        .task_id = s.task_id,
+        .score = s.score,
+        .timestamp = s.timestamp,
     }};
-  }
-  resp.set_sync_tag(max_id + 1);
+  });
+  resp.set_sync_tag(std::max<int64_t>({1, min_id - 1, max_id}) + 1);
 
   utils::ok(r, resp);
 }
 
 coro<void> get_user_summary(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
   co_await require_auth(r, routes::Permission::ADMIN);
 }
 
 coro<void> get_submission_summary(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
-  co_await require_auth(r, routes::Permission::ADMIN);
+  auto session = co_await require_auth(r, routes::Permission::ADMIN);
+  auto db = async::pq::connection_pool::local->get_lazy_connection(
+      {.prio = async::pq::priority::LOW,
+       .replicas = session->routing_for_reads(async::pq::replica_routing::READ_ONLY_QUERIES)});
 
   auto request = utils::expect<api::SubmissionSummaryRequest>(r);
 
@@ -28,13 +28,6 @@ ORDER BY
     user_id,
     submit_time DESC;
 
--- Get readable usernames
-SELECT
-    id,
-    display_name
-FROM (users
-    JOIN unnest(`users`::bigint[]) AS ids ON id = ids);
-
 -- Get users of group
 SELECT
     user_id,
@@ -45,6 +38,7 @@ WHERE
     group_id = `group_id`;
 
 -- Get user submissions
+--  read-only
 SELECT
     score,
     submit_time,
@@ -9,8 +9,9 @@
 using async::coro;
 
 static coro<void> handle_list(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
-  co_await require_auth(r, routes::Permission::NONE);
+  auto session = co_await require_auth(r, routes::Permission::NONE);
+  auto db = async::pq::connection_pool::local->get_lazy_connection(
+      {.replicas = session->routing_for_reads(async::pq::replica_routing::ALL)});
 
   api::TaskTypeListResponse ans{};
 
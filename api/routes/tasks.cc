@@ -3,6 +3,9 @@
 #include "async/coro.h"
 #include "async/pq.h"
 #include "routes.h"
+#include "routes/attachment-cache.h"
+#include "routes/kim-cache.h"
+#include "routes/scoreboard.h"
 #include "routes/session.h"
 #include "tasks.pb.h"
 #include "utils/api.h"
@@ -14,7 +17,7 @@ using async::coro;
 
 namespace {
 coro<void> handle_get(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
+  auto db = async::pq::connection_pool::local->get_lazy_connection();
   co_await require_auth(r, routes::Permission::ADMIN);
 
   int64_t task_id = utils::expect<int64_t>(r, "id");
@@ -114,7 +117,7 @@ const char ATTACHMENT_UPDATE_SQL[] =
 	  "deleted = (CASE WHEN $10 THEN excluded ELSE task_attachments END).deleted "
 	"WHERE "
 	  "task_attachments.task_id = excluded.task_id "
-	"RETURNING (xmax = 0)";
+	"RETURNING (xmax = 0), task_attachments.hash";
 
 const char TASK_LIST_SQL[] =
 	"SELECT "
@@ -215,8 +218,18 @@ const std::vector<utils::transform_rule> RULES_SANITIZE = {
 
 std::atomic<utils::transform_rules> TRANSFORM_SANITIZE = nullptr;
 
+bool is_attachment_hash(std::string_view hash) {
+  return hash.size() == 64 && std::ranges::all_of(hash, [](char c) {
+           return ('0' <= c && c <= '9') || ('a' <= c && c <= 'f');
+         });
+}
+
+std::filesystem::path attachment_path(std::string_view hash) {
+  return std::filesystem::path(conf.files_dir) / hash.substr(0, 2) / hash.substr(2);
+}
+
 coro<void> handle_update(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
+  auto db = async::pq::connection_pool::local->get_lazy_connection();
   auto session = co_await require_auth(r, routes::Permission::ADMIN);
 
   auto task = utils::expect<api::Task>(r);
@@ -224,6 +237,7 @@ coro<void> handle_update(fcgx::request_t* r) {
     utils::err(r, api::INVALID_QUERY);
   }
   std::vector<std::pair<std::string, std::string const&>> files;
+  std::vector<std::string> changed_hashes;
   std::map<int64_t, std::string> id_map;
 
   co_await db.transaction();
@@ -232,6 +246,11 @@ coro<void> handle_update(fcgx::request_t* r) {
     std::string hash = SHA3_256_EMPTY;
     if (attachment.contents().size()) {
       hash = utils::b16_encode(utils::sha3_256(attachment.contents()));
+    } else if (attachment.uploaded_hash().size()) {
+      hash = attachment.uploaded_hash();
+      if (!is_attachment_hash(hash) || !std::filesystem::exists(attachment_path(hash))) {
+        utils::err(r, api::INVALID_QUERY);
+      }
     }
     id_map[attachment.id()] = hash;
   }
@@ -268,35 +287,95 @@ coro<void> handle_update(fcgx::request_t* r) {
 
   for (auto const& attachment : task.attachments()) {
     auto hash = id_map[attachment.id()];
-    auto [is_inserted] =
+    auto [is_inserted, stored_hash] =
         (co_await db.exec(ATTACHMENT_UPDATE_SQL, attachment.id(), task.id(), attachment.filename(),
                           attachment.has_filename(), attachment.mime_type(),
                           attachment.has_mime_type(), attachment.shown_to_user(),
                           attachment.has_shown_to_user(), attachment.deleted(),
                           attachment.has_deleted(), hash))
-            .expect1<bool>();
+            .expect1<bool, std::string>();
+    if (!is_inserted && (attachment.has_deleted() || attachment.has_filename() ||
+                         attachment.has_mime_type())) {
+      changed_hashes.push_back(std::move(stored_hash));
+    }
     if (is_inserted) {
       if (!session->is_owner_of(attachment.id())) {
         utils::err(r, api::EXTREMELY_SORRY);
       }
-      files.push_back({hash, attachment.contents()});
+      if (attachment.contents().size() || attachment.uploaded_hash().empty()) {
+        files.push_back({hash, attachment.contents()});
+      }
     }
   }
 
   co_await db.commit();
+  session->note_write();
+  // We do not know which KIMs contain the task, so drop everything.
+  routes::kim_cache::invalidate_all();
+  routes::scoreboard::invalidate_all();
+  for (auto const& hash : changed_hashes) {
+    routes::attachment_cache::invalidate(hash);
+  }
 
   for (auto const& [hash, content] : files) {
-    auto path = std::filesystem::path(conf.files_dir) / hash.substr(0, 2);
-    std::filesystem::create_directories(path);
-    std::ofstream out(path / hash.substr(2), std::ios::binary);
+    auto path = attachment_path(hash);
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream out(path, std::ios::binary);
     out << content;
   }
   utils::ok(r, utils::empty_payload{});
 }
 
-coro<void> handle_list(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
+// Accepts the file as a raw application/octet-stream body, so that its size is not limited by the
+// memory of a worker. The client then passes the returned hash in Task.Attachment.uploaded_hash.
+coro<void> handle_upload_attachment(fcgx::request_t* r) {
   co_await require_auth(r, routes::Permission::ADMIN);
+  if (r->body_type != fcgx::BODY_STREAM) {
+    utils::err(r, api::INVALID_QUERY);
+  }
+
+  // Temporary file lives in the same directory as the final one, so the rename is atomic and
+  // readers never observe partially written attachments.
+  auto files_dir = std::filesystem::path(conf.files_dir);
+  auto tmp_path = files_dir / (".upload-" + utils::b16_encode(utils::urandom(8)));
+  bool is_renamed = false;
+  utils::scope_guard tmp_guard([&] {
+    if (!is_renamed) {
+      std::error_code ec;
+      std::filesystem::remove(tmp_path, ec);
+    }
+  });
+
+  utils::sha3_256_hasher hasher;
+  {
+    std::filesystem::create_directories(files_dir);
+    std::ofstream out(tmp_path, std::ios::binary);
+    utils::ensure(!out, "opening " + tmp_path.string() + " failed");
+
+    // Kept off the coroutine frame, which would otherwise grow by the whole buffer.
+    std::size_t const BUFFER_SIZE = 65536;
+    auto buffer = std::make_unique<char[]>(BUFFER_SIZE);
+    while (std::size_t size = co_await r->read_body(buffer.get(), BUFFER_SIZE)) {
+      hasher.update({buffer.get(), size});
+      out.write(buffer.get(), (std::streamsize) size);
+    }
+    out.close();
+    utils::ensure(!out, "writing " + tmp_path.string() + " failed");
+  }
+
+  auto hash = utils::b16_encode(hasher.finish());
+  auto path = attachment_path(hash);
+  std::filesystem::create_directories(path.parent_path());
+  std::filesystem::rename(tmp_path, path);
+  is_renamed = true;
+
+  utils::ok<api::AttachmentUploadResponse>(r, {{.hash = hash}});
+}
+
+coro<void> handle_list(fcgx::request_t* r) {
+  auto session = co_await require_auth(r, routes::Permission::ADMIN);
+  auto db = async::pq::connection_pool::local->get_lazy_connection(
+      {.replicas = session->routing_for_reads(async::pq::replica_routing::ALL)});
 
   auto req = utils::expect<api::TaskListRequest>(r);
 
@@ -337,11 +416,12 @@ coro<void> handle_list(fcgx::request_t* r) {
 }
 
 coro<void> handle_bulk_delete(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
-  co_await require_auth(r, routes::Permission::ADMIN);
+  auto db = async::pq::connection_pool::local->get_lazy_connection();
+  auto session = co_await require_auth(r, routes::Permission::ADMIN);
 
   auto req = utils::expect<api::TaskBulkDeleteRequest>(r);
   co_await db.exec(TASK_BULK_DELETE_SQL, req.tasks());
+  session->note_write();
 
   utils::ok<utils::empty_payload>(r, {});
 }
@@ -349,5 +429,6 @@ coro<void> handle_bulk_delete(fcgx::request_t* r) {
 
 ROUTE_REGISTER("/tasks/$id", handle_get)
 ROUTE_REGISTER("/tasks/update", handle_update)
+ROUTE_REGISTER("/tasks/upload-attachment", handle_upload_attachment)
 ROUTE_REGISTER("/tasks/list", handle_list)
 ROUTE_REGISTER("/tasks/bulk-delete", handle_bulk_delete)
@@ -13,7 +13,7 @@ using async::coro;
 namespace {
 coro<void> handle_user_login(fcgx::request_t* r) {
   auto req = utils::expect<api::LoginRequest>(r);
-  auto db = co_await async::pq::connection_pool::local->get_connection();
+  auto db = async::pq::connection_pool::local->get_lazy_connection();
 
   auto q = co_await db.exec(
       "SELECT id, username, display_name, permissions, salt, password FROM users WHERE username "
@@ -30,18 +30,22 @@ coro<void> handle_user_login(fcgx::request_t* r) {
 
   auto session = std::make_shared<routes::session>(user_id, username, display_name, perms);
   auto session_id = utils::urandom(32);
+  if (conf.persistent_sessions) {
+    co_await db.exec("INSERT INTO sessions (id, user_id) VALUES ($1, $2)",
+                     routes::session::persistent_id(session_id), user_id);
+  }
   co_await routes::session::save(session, session_id);
 
   // FIXME: We need to enable SSL and not to remove "Secure;" here
+  auto max_age = std::chrono::duration_cast<std::chrono::seconds>(routes::session_max_age);
   r->headers.push_back(
-      fmt::format("Set-Cookie: kege-session={}; Path=/; Max-Age=86400; HttpOnly",
-                  utils::b16_encode(session_id)));
+      fmt::format("Set-Cookie: kege-session={}; Path=/; Max-Age={}; HttpOnly",
+                  utils::b16_encode(session_id), max_age.count()));
 
   utils::ok<api::UserInfo>(r, session->serialize());
 }
 
 coro<void> handle_user_info(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
   auto s = co_await require_auth(r, routes::Permission::NONE);
 
   utils::ok<api::UserInfo>(r, s->serialize());
@@ -49,19 +53,22 @@ coro<void> handle_user_info(fcgx::request_t* r) {
 
 coro<void> handle_user_logout(fcgx::request_t* r) {
   auto req = utils::expect<api::LogoutRequest>(r);
-  auto db = co_await async::pq::connection_pool::local->get_connection();
+  auto db = async::pq::connection_pool::local->get_lazy_connection();
   auto s = co_await require_auth(r, routes::Permission::NONE);
 
   if (s->user_id != req.user_id()) {
     utils::err(r, api::INVALID_QUERY);
   }
   s->logged_out = true;
+  if (conf.persistent_sessions) {
+    co_await db.exec("DELETE FROM sessions WHERE id = $1",
+                     routes::session::persistent_id(utils::b16_decode(r->cookies["kege-session"])));
+  }
   r->headers.push_back("Set-Cookie: kege-session=invalid; expires=Thu, 01 Jan 1970 00:00:00 GMT");
   utils::ok<utils::empty_payload>(r, {});
 }
 
 coro<void> handle_check_admin(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
   co_await require_auth(r, routes::Permission::ADMIN);
 }
 
@@ -82,7 +89,7 @@ coro<void> handle_request_id_range(fcgx::request_t* r) {
     return false;
   };
 
-  auto db = co_await async::pq::connection_pool::local->get_connection();
+  auto db = async::pq::connection_pool::local->get_lazy_connection();
   auto s = co_await require_auth(r, routes::Permission::ADMIN);
 
   int64_t block_len = 2;
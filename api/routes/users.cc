@@ -2,7 +2,10 @@
 
 #include "async/coro.h"
 #include "async/pq.h"
+#include "async/thread-pool.h"
 #include "routes.h"
+#include "routes/jobs.h"
+#include "routes/scoreboard.h"
 #include "routes/session.h"
 #include "users.pb.h"
 #include "users.sql.cc"
@@ -14,8 +17,9 @@ using async::coro;
 
 namespace {
 coro<void> list_users_as_plain_text(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
-  co_await require_auth(r, routes::Permission::ADMIN);
+  auto session = co_await require_auth(r, routes::Permission::ADMIN);
+  auto db = async::pq::connection_pool::local->get_lazy_connection(
+      {.replicas = session->routing_for_reads(async::pq::replica_routing::READ_ONLY_QUERIES)});
 
   r->mime_type = "text/plain;charset=UTF-8";
   r->fix_meta();
@@ -40,41 +44,42 @@ coro<void> list_users_as_plain_text(fcgx::request_t* r) {
   }
 }
 
-coro<void> replace_users(fcgx::request_t* r) {
-  auto db = co_await async::pq::connection_pool::local->get_connection();
-  co_await require_auth(r, routes::Permission::ADMIN);
-
-  co_await db.transaction();
-  co_await db.exec(DROP_ALL_USERS_REQUEST);
-  co_await db.exec(DROP_ALL_GROUPS_REQUEST);
+// Users are imported in batches, so the progress can be watched in the jobs list.
+constexpr std::size_t IMPORT_BATCH = 1024;
 
-  auto list = utils::expect<api::UserReplaceRequest>(r);
-  size_t user_count = static_cast<size_t>(list.users_size());
+char const COPY_USERS_SQL[] =
+    "COPY users (id, username, display_name, permissions, salt, password) FROM STDIN "
+    "(FORMAT binary)";
+char const COPY_GROUP_MAPPING_SQL[] =
+    "COPY users_groups (user_id, group_id) FROM STDIN (FORMAT binary)";
 
-  std::string passwords_owner;
-  std::vector<std::string_view> usernames, display_names, salts, passwords;
+// Progress is written outside of the import transaction, since it would not be visible until the
+// transaction is over. It is best effort, so an import never holds a second connection for long,
+// nor waits for one behind other requests.
+constexpr auto PROGRESS_ACQUIRE_TIMEOUT = std::chrono::milliseconds(100);
 
-  for (size_t i = 0; i < user_count; ++i) {
-    auto& user = list.users(static_cast<int>(i));
-    std::string salt = utils::urandom(32);
-    std::string password = utils::sha3_256(user.password() + salt);
+std::string import_status(int status, std::size_t imported, std::size_t total) {
+  return fmt::format("{:c}{}/{}", char(status), imported, total);
+}
 
-    usernames.push_back(user.username());
-    display_names.push_back(user.display_name());
-    passwords_owner += salt;
-    passwords_owner += password;
+coro<void> report_progress(int64_t job_id, std::size_t imported, std::size_t total) {
+  auto jobs_db = async::pq::connection_pool::local->get_lazy_connection(
+      {.prio = async::pq::priority::LOW, .timeout = PROGRESS_ACQUIRE_TIMEOUT});
+  auto status = import_status(routes::job_users_import::IMPORTING, imported, total);
+  try {
+    co_await jobs_db.exec(UPDATE_IMPORT_JOB_REQUEST);
+  } catch (async::pq::pool_exhausted_error const&) {
+    // The next batch will report it
   }
+}
 
-  passwords_owner = utils::b16_encode(passwords_owner);
-  for (size_t i = 0; i < user_count; ++i) {
-    salts.push_back(std::string_view(passwords_owner).substr(128 * i, 64));
-    passwords.push_back(std::string_view(passwords_owner).substr(128 * i + 64, 64));
-  }
+coro<void> import_users(int64_t job_id, api::UserReplaceRequest const& list) {
+  auto db = async::pq::connection_pool::local->get_lazy_connection();
+  auto user_count = static_cast<std::size_t>(list.users_size());
 
-  std::vector<int64_t> user_ids;
-  for (auto [id] : co_await db.exec(ADD_USERS_REQUEST)) {
-    user_ids.push_back(id);
-  }
+  co_await db.transaction();
+  co_await db.exec(DROP_ALL_USERS_REQUEST);
+  co_await db.exec(DROP_ALL_GROUPS_REQUEST);
 
   std::vector<std::string_view> group_names;
   for (int i = 0; i < list.groups_size(); ++i) {
@@ -85,19 +90,91 @@ coro<void> replace_users(fcgx::request_t* r) {
     group_ids.push_back(id);
   }
 
-  std::vector<int64_t> map_user_id, map_group_id;
-  for (size_t i = 0; i < user_count; ++i) {
-    for (auto group : list.users(static_cast<int>(i)).groups()) {
-      map_user_id.push_back(user_ids[i]);
-      map_group_id.push_back(group_ids[group]);
+  // COPY cannot return generated ids, so they are taken from the sequence beforehand.
+  std::vector<int64_t> user_ids;
+  for (auto [id] : co_await db.exec(ALLOCATE_USER_IDS_REQUEST)) {
+    user_ids.push_back(id);
+  }
+
+  // Salts and hashes are stored b16-encoded
+  std::vector<std::string> salts(user_count), passwords(user_count);
+  for (std::size_t start = 0; start < user_count; start += IMPORT_BATCH) {
+    auto end = std::min(start + IMPORT_BATCH, user_count);
+
+    // Hashing thousands of passwords would stall every request of the worker.
+    co_await async::parallel_for(end - start, [&](std::size_t i) {
+      i += start;
+      std::string salt = utils::urandom(32);
+      passwords[i] = utils::b16_encode(utils::sha3_256(list.users(int(i)).password() + salt));
+      salts[i] = utils::b16_encode(salt);
+    });
+
+    auto rows = std::views::iota(start, end) | std::views::transform([&](std::size_t i) {
+                  auto const& user = list.users(int(i));
+                  return std::tuple<int64_t, std::string_view, std::string_view, int,
+                                    std::string_view, std::string_view>{
+                      user_ids[i], user.username(), user.display_name(), 0, salts[i],
+                      passwords[i]};
+                });
+    co_await db.copy_from(COPY_USERS_SQL, rows);
+
+    co_await report_progress(job_id, end, user_count);
+  }
+
+  std::vector<std::tuple<int64_t, int64_t>> mapping;
+  for (std::size_t i = 0; i < user_count; ++i) {
+    for (auto group : list.users(int(i)).groups()) {
+      mapping.emplace_back(user_ids[i], group_ids[std::size_t(group)]);
     }
   }
-  co_await db.exec(ADD_GROUP_MAPPING_REQUEST);
+  co_await db.copy_from(COPY_GROUP_MAPPING_SQL, mapping);
 
   co_await db.commit();
+}
+
+// The import holds its connection only until it is over, so the job is created and finished
+// through another one without ever needing two at once.
+coro<void> replace_users(fcgx::request_t* r) {
+  auto session = co_await require_auth(r, routes::Permission::ADMIN);
+
+  auto list = utils::expect<api::UserReplaceRequest>(r);
+  auto user_count = static_cast<std::size_t>(list.users_size());
+  for (auto const& user : list.users()) {
+    for (auto group : user.groups()) {
+      if (group < 0 || group >= list.groups_size()) {
+        utils::err(r, api::INVALID_QUERY);
+      }
+    }
+  }
+
+  int64_t job_id;
+  {
+    auto jobs_db = async::pq::connection_pool::local->get_lazy_connection();
+    auto status = import_status(routes::job_users_import::IMPORTING, 0, user_count);
+    job_id = std::get<0>((co_await jobs_db.exec(CREATE_IMPORT_JOB_REQUEST)).expect1());
+  }
+
+  std::exception_ptr error;
+  try {
+    co_await import_users(job_id, list);
+  } catch (...) {
+    error = std::current_exception();
+  }
+
+  auto final_status = error ? routes::job_users_import::FAILED : routes::job_users_import::DONE;
+  auto status = import_status(final_status, error ? 0 : user_count, user_count);
+  auto jobs_db = async::pq::connection_pool::local->get_lazy_connection();
+  co_await jobs_db.exec(UPDATE_IMPORT_JOB_REQUEST);
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  session->note_write();
+  // Every group has been recreated
+  routes::scoreboard::invalidate_all();
   utils::ok<utils::empty_payload>(r, {});
 }
+}  // namespace
 
 ROUTE_REGISTER("/users/html-list", list_users_as_plain_text)
 ROUTE_REGISTER("/users/replace", replace_users)
-}  // namespace
@@ -1,4 +1,5 @@
 -- List groups
+--  read-only
 SELECT
     id,
     display_name
@@ -6,6 +7,7 @@ FROM
     groups;
 
 -- List all users
+--  read-only
 SELECT
     id,
     username,
@@ -15,6 +17,7 @@ FROM
     users;
 
 -- List group mapping
+--  read-only
 SELECT
     user_id,
     group_id
@@ -23,11 +26,11 @@ FROM
 ORDER BY
     group_id;
 
--- Add users
-INSERT INTO users (username, display_name, permissions, salt, password)
-    VALUES (unnest(`usernames`::text[]), unnest(`display_names`::text[]), 0, unnest(`salts`::text[]), unnest(`passwords`::text[]))
-RETURNING
-    id;
+-- Allocate user ids
+SELECT
+    nextval('builtin_id_sequence')
+FROM
+    generate_series(1, `static_cast<int>(user_count)`::integer);
 
 -- Drop all users
 DELETE FROM users
@@ -44,7 +47,17 @@ INSERT INTO groups (display_name)
 RETURNING
     id;
 
--- Add group mapping
-INSERT INTO users_groups (user_id, group_id)
-    VALUES (unnest(`map_user_id`::bigint[]), unnest(`map_group_id`::bigint[]));
+-- Create import job
+INSERT INTO jobs (id, type, status)
+    VALUES (nextval('builtin_id_sequence'), `routes::job_users_import::DB_TYPE`, `std::string_view(status)`)
+RETURNING
+    id;
+
+-- Update import job
+UPDATE
+    jobs
+SET
+    status = `std::string_view(status)`
+WHERE
+    id = `job_id`;
 
@@ -1,12 +1,127 @@
 #include "async/coro.h"
 using namespace async;
 
+/* ==== async::detail::allocate_frame ==== */
+namespace {
+// Frames are rounded up to FRAME_GRANULARITY bytes. Ones larger than MAX_POOLED_FRAME go straight
+// to the global allocator, as do frames freed when the corresponding list is already full.
+constexpr std::size_t FRAME_GRANULARITY = 64;
+constexpr std::size_t MAX_POOLED_FRAME = 4096;
+constexpr std::size_t SIZE_CLASSES = MAX_POOLED_FRAME / FRAME_GRANULARITY;
+constexpr std::size_t MAX_FREE_FRAMES = 256;
+
+struct free_frame {
+  free_frame* next;
+};
+
+struct frame_counters {
+  std::atomic<uint64_t> allocated = 0;
+  std::atomic<uint64_t> reused = 0;
+};
+
+std::mutex counters_lock;
+std::set<frame_counters*> thread_counters;
+// Counters of threads which have already exited.
+frame_counters retired_counters;
+
+// Coroutines destroyed during thread exit might outlive the cache.
+thread_local bool cache_destroyed = false;
+
+struct frame_cache {
+  free_frame* lists[SIZE_CLASSES] = {};
+  std::size_t lengths[SIZE_CLASSES] = {};
+  frame_counters counters;
+
+  frame_cache() {
+    std::lock_guard guard(counters_lock);
+    thread_counters.insert(&counters);
+  }
+
+  ~frame_cache() {
+    cache_destroyed = true;
+    for (auto list : lists) {
+      while (list) {
+        auto next = list->next;
+        ::operator delete(list);
+        list = next;
+      }
+    }
+
+    std::lock_guard guard(counters_lock);
+    thread_counters.erase(&counters);
+    retired_counters.allocated += counters.allocated;
+    retired_counters.reused += counters.reused;
+  }
+};
+
+thread_local frame_cache cache;
+
+std::size_t size_class(std::size_t size) {
+  return (size - 1) / FRAME_GRANULARITY;
+}
+}  // namespace
+
+frame_allocator_stats async::get_frame_allocator_stats() {
+  std::lock_guard guard(counters_lock);
+  frame_allocator_stats result{retired_counters.allocated, retired_counters.reused};
+  for (auto counters : thread_counters) {
+    result.allocated += counters->allocated.load(std::memory_order_relaxed);
+    result.reused += counters->reused.load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+void* async::get_task_context() {
+  return detail::current_task_context;
+}
+
+void* detail::allocate_frame(std::size_t size) {
+  if (cache_destroyed) {
+    return ::operator new(size);
+  }
+  if (size <= MAX_POOLED_FRAME) {
+    auto id = size_class(size);
+    if (auto frame = cache.lists[id]) {
+      cache.lists[id] = frame->next;
+      --cache.lengths[id];
+      cache.counters.reused.fetch_add(1, std::memory_order_relaxed);
+      return frame;
+    }
+    size = (id + 1) * FRAME_GRANULARITY;
+  }
+  cache.counters.allocated.fetch_add(1, std::memory_order_relaxed);
+  return ::operator new(size);
+}
+
+void detail::deallocate_frame(void* ptr, std::size_t size) noexcept {
+  if (!cache_destroyed && size <= MAX_POOLED_FRAME) {
+    auto id = size_class(size);
+    if (cache.lengths[id] < MAX_FREE_FRAMES) {
+      auto frame = new (ptr) free_frame{cache.lists[id]};
+      cache.lists[id] = frame;
+      ++cache.lengths[id];
+      return;
+    }
+  }
+  ::operator delete(ptr);
+}
+
 /* ==== async::detail::promise_type_facade ==== */
+void* detail::promise_type_facade::operator new(std::size_t size) {
+  return allocate_frame(size);
+}
+
+void detail::promise_type_facade::operator delete(void* ptr, std::size_t size) noexcept {
+  deallocate_frame(ptr, size);
+}
+
 std::suspend_never detail::promise_type_facade::initial_suspend() noexcept {
   return {};
 }
 
-void detail::promise_type_facade::final_suspend_inner(std::coroutine_handle<> h) noexcept {
+std::coroutine_handle<> detail::promise_type_facade::final_suspend_inner(
+    std::coroutine_handle<> h) noexcept {
+  current_task_context = outer_task_context;
   if (is_top_level) {
     --event_loop::local->alive_coroutines;
     if (exc.has_value()) {
@@ -15,15 +130,21 @@ void detail::promise_type_facade::final_suspend_inner(std::coroutine_handle<> h)
     if (destroy_on_done) {
       event_loop::local->schedule_work(event_loop_work::create_destroyer(h));
     }
-  } else if (parent.has_value()) {
-    event_loop::local->schedule_work(std::move(parent.value()));
+  } else if (parent) {
+    return parent;
   }
+  return std::noop_coroutine();
 }
 
 void detail::promise_type_facade::unhandled_exception() {
   exc = std::current_exception();
 }
 
+std::suspend_never detail::promise_type_facade::await_transform(set_task_context c) noexcept {
+  task_context = current_task_context = c.context;
+  return {};
+}
+
 /* ==== async::suspend_t ==== */
 void suspend_t::await_suspend(std::coroutine_handle<> h) noexcept {
   event_loop::local->schedule_work(event_loop_work(h));
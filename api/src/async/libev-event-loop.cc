@@ -43,40 +43,152 @@ struct data_t {
 
 typedef struct ev_loop ev_loop_t;
 
+namespace {
+/**
+ * FIFO queue on top of a ring buffer.
+ *
+ * Grows (by doubling) only when full, so once the loop has seen its peak load, pushing and popping
+ * do not allocate.
+ */
+template <typename T>
+class ring_queue {
+private:
+  std::unique_ptr<T[]> data;
+  std::size_t mask;
+  std::size_t head = 0, tail = 0;
+
+  void grow() {
+    std::size_t capacity = mask + 1;
+    auto new_data = std::make_unique<T[]>(capacity * 2);
+    for (std::size_t i = 0; i < capacity; ++i) {
+      new_data[i] = std::move(data[(head + i) & mask]);
+    }
+    data = std::move(new_data);
+    head = 0;
+    tail = capacity;
+    mask = capacity * 2 - 1;
+  }
+
+public:
+  /** @param[in]  capacity  Initial capacity, must be a power of two */
+  ring_queue(std::size_t capacity) : data(std::make_unique<T[]>(capacity)), mask(capacity - 1) {
+    assert(capacity && !(capacity & mask));
+  }
+
+  bool empty() const {
+    return head == tail;
+  }
+
+  std::size_t size() const {
+    return tail - head;
+  }
+
+  void push(T&& value) {
+    if (tail - head == mask + 1) {
+      grow();
+    }
+    data[tail++ & mask] = std::move(value);
+  }
+
+  T pop() {
+    return std::move(data[head++ & mask]);
+  }
+};
+
+/**
+ * Allocator of same-sized objects which never returns memory until destroyed.
+ *
+ * Memory is taken in chunks and recycled through an intrusive free list. Objects still alive when
+ * the pool is destroyed are not destructed.
+ */
+template <typename T>
+class object_pool {
+private:
+  union slot {
+    slot* next;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  static constexpr std::size_t CHUNK_SIZE = 64;
+
+  std::vector<std::unique_ptr<slot[]>> chunks;
+  slot* free_list = nullptr;
+
+public:
+  template <typename... Args>
+  T* create(Args&&... args) {
+    if (!free_list) {
+      auto& chunk = chunks.emplace_back(std::make_unique<slot[]>(CHUNK_SIZE));
+      for (std::size_t i = 0; i < CHUNK_SIZE; ++i) {
+        chunk[i].next = free_list;
+        free_list = &chunk[i];
+      }
+    }
+    slot* s = free_list;
+    free_list = s->next;
+    return new (s->storage) T{std::forward<Args>(args)...};
+  }
+
+  void destroy(T* ptr) {
+    ptr->~T();
+    auto s = reinterpret_cast<slot*>(ptr);
+    s->next = free_list;
+    free_list = s;
+  }
+};
+}  // namespace
+
 /** @private */
 struct libev_event_loop::impl {
+  using timer_event = ev_with_arg<ev_timer, data_t>;
+  using io_event = ev_with_arg<ev_io>;
+
   struct delayed_work {
     ev_timer w;
     func_ptr work;
-    std::list<delayed_work>::iterator self;
     double timeout;
     libev_event_loop::impl* pimpl;
+    // Pending jobs form an intrusive list, so they can be dropped when the loop stops.
+    delayed_work* prev = nullptr;
+    delayed_work* next = nullptr;
   };
 
+  static constexpr std::size_t INITIAL_QUEUE_CAPACITY = 1024;
+
   std::vector<std::shared_ptr<event_source>> sources;
   ev_loop_t* loop;
 
   ev_with_arg<ev_async> stop_notifier;
+  ev_with_arg<ev_async> post_notifier;
+  std::mutex posted_lock;
+  std::vector<std::function<void()>> posted;
 
   ev_with_arg<ev_prepare> worker;
 
-  std::list<delayed_work> delayed_jobs;
-  std::queue<event_loop_work> queue;
+  // Watchers of the loop are recycled instead of being allocated for each suspension.
+  object_pool<timer_event> timers;
+  object_pool<io_event> ios;
+  object_pool<delayed_work> delayed_pool;
+
+  delayed_work* delayed_jobs = nullptr;
+  ring_queue<event_loop_work> queue{INITIAL_QUEUE_CAPACITY};
   bool until_complete = 1;
   bool success_flag = 1;
 
   static void timer_cb(ev_loop_t* loop, ev_timer* w_, int) {
-    auto w = (ev_with_arg<ev_timer, data_t>*) (w_);
+    auto w = (timer_event*) (w_);
     ev_timer_stop(loop, &w->w);
-    ((sleep*) w->arg.ext.vptr)->work.do_work();
-    delete w;
+    auto obj = (sleep*) w->arg.ext.vptr;
+    ((impl*) ev_userdata(loop))->timers.destroy(w);
+    obj->work.do_work();
   }
 
   static void delayed_cb(ev_loop_t* loop, ev_timer* w_, int) {
-    auto& job = *reinterpret_cast<delayed_work*>(w_);
-    ev_timer_stop(loop, &job.w);
-    job.work->operator()();
-    job.pimpl->delayed_jobs.erase(job.self);
+    auto job = reinterpret_cast<delayed_work*>(w_);
+    ev_timer_stop(loop, &job->w);
+    job->work->operator()();
+    job->pimpl->delayed_unlink(job);
+    job->pimpl->delayed_pool.destroy(job);
   }
 
   static void socket_cb(ev_loop_t*, ev_io* w, int revents) {
@@ -87,13 +199,27 @@ struct libev_event_loop::impl {
     }
   }
 
+  void delayed_link(delayed_work* job) {
+    job->next = delayed_jobs;
+    if (delayed_jobs) {
+      delayed_jobs->prev = job;
+    }
+    delayed_jobs = job;
+  }
+
+  void delayed_unlink(delayed_work* job) {
+    (job->prev ? job->prev->next : delayed_jobs) = job->next;
+    if (job->next) {
+      job->next->prev = job->prev;
+    }
+  }
+
   void process_event(data_t data) {
     switch (data.type) {
       case data_t::NEW_TIMEOUT: {
-        auto* timer_event = new ev_with_arg<ev_timer, data_t>{{}, std::move(data)};
-        ev_timer_init(&timer_event->w, timer_cb, ((sleep*) timer_event->arg.ext.vptr)->duration,
-                      0.);
-        ev_timer_start(loop, &timer_event->w);
+        auto event = timers.create(ev_timer{}, data);
+        ev_timer_init(&event->w, timer_cb, ((sleep*) data.ext.vptr)->duration, 0.);
+        ev_timer_start(loop, &event->w);
         break;
       }
 
@@ -106,27 +232,27 @@ struct libev_event_loop::impl {
 
       case data_t::NEW_SOCKET: {
         auto storage = (socket_storage*) data.ext.vptr;
-        auto io_event = new ev_with_arg<ev_io>{{}, storage};
-        storage->event = io_event;
-        ev_io_init(&io_event->w, socket_cb, storage->fd, storage->event_mask);
-        ev_io_start(loop, &io_event->w);
+        auto event = ios.create(ev_io{}, storage);
+        storage->event = event;
+        ev_io_init(&event->w, socket_cb, storage->fd, storage->event_mask);
+        ev_io_start(loop, &event->w);
         break;
       }
 
       case data_t::DEL_SOCKET: {
         auto storage = (socket_storage*) data.ext.vptr;
-        auto event = (ev_with_arg<ev_io>*) storage->event;
+        auto event = (io_event*) storage->event;
         ev_io_stop(loop, &event->w);
-        delete event;
+        ios.destroy(event);
         break;
       }
 
       case data_t::MOD_SOCKET: {
         auto storage = (socket_storage*) data.ext.vptr;
-        auto io_event = (ev_with_arg<ev_io>*) storage->event;
-        ev_io_stop(loop, &io_event->w);
-        ev_io_init(&io_event->w, socket_cb, storage->fd, storage->event_mask);
-        ev_io_start(loop, &io_event->w);
+        auto event = (io_event*) storage->event;
+        ev_io_stop(loop, &event->w);
+        ev_io_init(&event->w, socket_cb, storage->fd, storage->event_mask);
+        ev_io_start(loop, &event->w);
         break;
       }
     }
@@ -152,19 +278,41 @@ struct libev_event_loop::impl {
     p->until_complete = true;
   }
 
+  static void post_notifier_cb(ev_loop_t*, ev_async* w, int) {
+    auto p = (impl*) ((ev_with_arg<ev_async>*) w)->arg;
+
+    std::vector<std::function<void()>> current;
+    {
+      std::lock_guard guard(p->posted_lock);
+      current.swap(p->posted);
+    }
+    for (auto& func : current) {
+      func();
+    }
+  }
+
+  void post(std::function<void()> func) {
+    {
+      std::lock_guard guard(posted_lock);
+      posted.push_back(std::move(func));
+    }
+    ev_async_send(loop, &post_notifier.w);
+  }
+
   static void worker_cb(ev_loop_t* loop, ev_prepare* w, int) {
     auto p = (impl*) ((ev_with_arg<ev_prepare>*) w)->arg;
 
-    while (p->queue.size()) {
-      p->queue.front().do_work();
-      p->queue.pop();
+    while (!p->queue.empty()) {
+      // Popped before running, since the work may push more and thus move the buffer.
+      p->queue.pop().do_work();
     }
 
-    if (p->queue.empty() && p->until_complete && !event_loop::local->alive_coroutines) {
-      for (auto& job : p->delayed_jobs) {
-        ev_timer_stop(loop, &job.w);
+    if (p->until_complete && !event_loop::local->alive_coroutines) {
+      while (auto job = p->delayed_jobs) {
+        ev_timer_stop(loop, &job->w);
+        p->delayed_unlink(job);
+        p->delayed_pool.destroy(job);
       }
-      p->delayed_jobs.clear();
       ev_break(loop, EVBREAK_ALL);
       for (auto source : p->sources) {
         source->on_stop();
@@ -181,11 +329,16 @@ struct libev_event_loop::impl {
     if (!loop) {
       throw std::runtime_error("unable to create libev event loop");
     }
+    ev_set_userdata(loop, this);
 
     ev_async_init(&stop_notifier.w, stop_notifier_cb);
     stop_notifier.arg = this;
     ev_async_start(loop, &stop_notifier.w);
 
+    ev_async_init(&post_notifier.w, post_notifier_cb);
+    post_notifier.arg = this;
+    ev_async_start(loop, &post_notifier.w);
+
     ev_prepare_init(&worker.w, worker_cb);
     worker.arg = this;
     ev_prepare_start(loop, &worker.w);
@@ -193,6 +346,7 @@ struct libev_event_loop::impl {
 
   ~impl() {
     ev_async_stop(loop, &stop_notifier.w);
+    ev_async_stop(loop, &post_notifier.w);
     ev_loop_destroy(loop);
   }
 };
@@ -212,6 +366,10 @@ void* libev_event_loop::get_underlying_loop() {
   return pimpl->loop;
 }
 
+std::size_t libev_event_loop::ready_queue_size() const {
+  return pimpl->queue.size();
+}
+
 bool libev_event_loop::run(bool until_complete) {
   if (!pimpl) {
     throw std::invalid_argument("unable to start event loop again");
@@ -227,6 +385,10 @@ void libev_event_loop::schedule_work(event_loop_work&& work) {
   pimpl->queue.push(std::move(work));
 }
 
+void libev_event_loop::post(std::function<void()> func) {
+  pimpl->post(std::move(func));
+}
+
 void libev_event_loop::handle_exception(std::exception_ptr const& exc) {
   try {
     std::rethrow_exception(exc);
@@ -252,10 +414,9 @@ void libev_event_loop::schedule_timer_resume(sleep* obj) {
 }
 
 void libev_event_loop::schedule_timeout(func_ptr delayed_scheduler, double timeout) {
-  pimpl->delayed_jobs.push_front({{}, std::move(delayed_scheduler), {}, timeout, pimpl});
-  pimpl->delayed_jobs.front().self = pimpl->delayed_jobs.begin();
-  pimpl->process_event(
-      {.type = data_t::NEW_DELAYED, .ext = {.vptr = &pimpl->delayed_jobs.front()}});
+  auto job = pimpl->delayed_pool.create(ev_timer{}, std::move(delayed_scheduler), timeout, pimpl);
+  pimpl->delayed_link(job);
+  pimpl->process_event({.type = data_t::NEW_DELAYED, .ext = {.vptr = job}});
 }
 
 void libev_event_loop::socket_add(socket_storage* storage) {
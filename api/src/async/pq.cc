@@ -6,6 +6,8 @@
 #include "KEGE.h"
 #include "async/future.h"
 #include "async/socket.h"
+#include "async/tracing.h"
+#include "utils/common.h"
 using namespace async;
 using namespace pq;
 
@@ -17,24 +19,93 @@ connection_storage::~connection_storage() {
 
 /* ==== async::pq::connection ==== */
 coro<void> connection::rollback_and_return(raw_connection conn, connection_pool* pool) {
-  co_await pq::detail::exec(*conn, "ROLLBACK", 0, nullptr, nullptr, nullptr);
+  co_await pq::detail::exec(*conn, {"ROLLBACK", nullptr, 0, nullptr, nullptr, nullptr});
   pool->return_connection(conn);
 }
 
 connection::connection(raw_connection conn_, connection_pool* pool_) : conn(conn_), pool(pool_) {}
 
+connection::connection(connection_pool* pool_, acquire_options const& options_)
+    : pool(pool_), options(options_), routing(options_.replicas) {}
+
 connection::~connection() {
-  if (conn) {
+  // A transaction is bound to the connection which has received BEGIN, i.e. to the replica only if
+  // all queries are routed there.
+  auto release = [this](raw_connection const& c, connection_pool* p) {
+    if (!c) {
+      return;
+    }
     if (!has_active_transaction) {
-      pool->return_connection(conn);
+      p->return_connection(c);
     } else {
-      async::schedule_detached(connection::rollback_and_return(conn, pool));
+      async::schedule_detached(
+          async::without_task_context([&] { return connection::rollback_and_return(c, p); }));
     }
-  }
+  };
+  release(replica_conn, replica_pool);
+  release(conn, pool);
 }
 
 PGconn* connection::get_raw_connection() const noexcept {
-  return conn->conn;
+  return conn ? conn->conn : nullptr;
+}
+
+coro<void> connection::acquire() const {
+  auto acquired = co_await pool->acquire(options);
+  // Another query might have been issued meanwhile
+  if (conn) {
+    pool->return_connection(acquired);
+  } else {
+    conn = std::move(acquired);
+  }
+}
+
+coro<void> connection::acquire_replica() const {
+  raw_connection acquired;
+  auto replica = connection_pool::pick_replica();
+  if (replica) {
+    try {
+      acquired = co_await replica->acquire(options);
+    } catch (db_error const&) {
+      // Falls back to the primary below
+    }
+  }
+  if (!acquired) {
+    routing = replica_routing::NONE;
+  } else if (replica_conn || routing == replica_routing::NONE) {
+    // Another query might have been issued meanwhile
+    replica->return_connection(acquired);
+  } else {
+    replica_conn = std::move(acquired);
+    replica_pool = replica;
+  }
+}
+
+bool connection::pin_to_primary() const {
+  routing = replica_routing::NONE;
+  if (!replica_conn) {
+    return false;
+  }
+  replica_pool->return_connection(std::move(replica_conn));
+  replica_conn = nullptr;
+  return true;
+}
+
+coro<connection_storage*> connection::storage_for(bool read_only) const {
+  if (routing == replica_routing::ALL || (routing != replica_routing::NONE && read_only)) {
+    if (!replica_conn) {
+      co_await acquire_replica();
+    }
+    if (replica_conn) {
+      co_return replica_conn.get();
+    }
+  } else if (routing != replica_routing::NONE) {
+    pin_to_primary();
+  }
+  if (!conn) {
+    co_await acquire();
+  }
+  co_return conn.get();
 }
 
 coro<void> connection::transaction() {
@@ -64,18 +135,84 @@ coro<void> connection::rollback() {
 /* ==== async::pq::connection_pool::impl ==== */
 /** @private */
 struct connection_pool::impl {
+  // Connections above the minimal size of the pool which stayed idle for the whole interval are
+  // closed at the end of it.
+  static constexpr auto SHRINK_INTERVAL = std::chrono::seconds(30);
+  static constexpr std::size_t PRIORITIES = 3;
+  static constexpr auto LAG_PROBE_INTERVAL = std::chrono::seconds(1);
+  // Replay timestamp is only updated when a transaction is replayed, so a replica which has
+  // replayed everything it received counts as not lagging even if the primary has been idle.
+  static constexpr char const* LAG_QUERY =
+      "SELECT coalesce(CASE WHEN pg_last_wal_receive_lsn() = pg_last_wal_replay_lsn() THEN 0 "
+      "ELSE extract(epoch FROM now() - pg_last_xact_replay_timestamp()) END, 0)::float8";
+
+  struct waiter {
+    future<raw_connection> fut;
+    bool is_done = false;
+  };
+  // Waiters are shared with their deadline timers, which might fire after the waiter is served.
+  using waiter_ptr = std::shared_ptr<waiter>;
+
   std::string db_path;
-  std::size_t conns_desired, conns_alive = 0;
-  bool stop_requested = false;
+  std::size_t conns_min, conns_max, conns_alive = 0;
+  // Connections above the minimal size which are still being opened
+  std::size_t conns_opening = 0;
+  std::size_t reconnects = 0;
+  bool stop_requested = false, is_initialized = false;
 
-  clock::duration creation_cooldown;
+  clock::duration creation_cooldown, acquire_timeout;
   clock::time_point last_failure;
 
+  bool is_replica;
+  clock::duration max_replica_lag;
+  // Replicas are not used until their lag is measured for the first time.
+  bool is_lagging = true;
+  // Probes are not stacked up while the replica is slow to respond.
+  bool is_probing = false;
+
   std::vector<raw_connection> pool;
-  std::queue<future<raw_connection>*> requests;
+  // Least number of idle connections since the last shrink
+  std::size_t idle_low_watermark = 0;
+  // Indexed by priority; a waiter is only served when there are no waiters of higher priorities.
+  std::array<std::deque<waiter_ptr>, PRIORITIES> requests;
 
   raw_connection create_connection() {
-    auto conn = PQconnectdb(db_path.c_str());
+    return register_connection(PQconnectdb(db_path.c_str()));
+  }
+
+  // Same as create_connection, but does not block the loop while connecting.
+  coro<raw_connection> create_connection_async() {
+    auto conn = PQconnectStart(db_path.c_str());
+    if (!conn || PQstatus(conn) == CONNECTION_BAD) {
+      PQfinish(conn);
+      co_return {};
+    }
+
+    // Socket might change between the polls (e.g. when trying the next host).
+    socket_storage sock;
+    auto loop = libev_event_loop::get();
+    auto status = PGRES_POLLING_WRITING;
+    while (status != PGRES_POLLING_OK && status != PGRES_POLLING_FAILED) {
+      auto wanted = status == PGRES_POLLING_READING ? READABLE : WRITABLE;
+      if (sock.fd != PQsocket(conn)) {
+        if (sock.event) {
+          loop->socket_del(&sock);
+        }
+        sock.fd = PQsocket(conn);
+        sock.event_mask = wanted;
+        loop->socket_add(&sock);
+      } else if (sock.event_mask != wanted) {
+        sock.event_mask = wanted;
+        loop->socket_mod(&sock);
+      }
+      co_await socket_performer{wanted, &sock};
+      status = PQconnectPoll(conn);
+    }
+    loop->socket_del(&sock);
+    co_return register_connection(conn);
+  }
+
+  raw_connection register_connection(PGconn* conn) {
     if (PQstatus(conn) != CONNECTION_OK || PQsetnonblocking(conn, 1)) {
       PQfinish(conn);
       return {};
@@ -90,15 +227,21 @@ struct connection_pool::impl {
     return storage;
   }
 
+  bool can_create_connection(clock::time_point now) const {
+    return now - last_failure >= creation_cooldown;
+  }
+
   auto populate_pool() {
     auto now = clock::now();
-    if (now - last_failure < creation_cooldown) {
+    if (!can_create_connection(now)) {
       return;
     }
     bool had_failure = false;
-    for (auto i = conns_alive; i < conns_desired; ++i) {
+    for (auto i = conns_alive; i < conns_min; ++i) {
       auto conn = create_connection();
       if (conn) {
+        // Pool only drops below the minimal size after start-up when connections are lost.
+        reconnects += is_initialized;
         return_connection(conn, true);
       } else {
         had_failure = true;
@@ -109,78 +252,237 @@ struct connection_pool::impl {
     }
   }
 
+  // Starts opening a connection above the minimal size if every connection is busy. The
+  // connection is handed to the first waiter once it is ready.
+  void grow_pool() {
+    if (conns_alive + conns_opening >= conns_max || !can_create_connection(clock::now())) {
+      return;
+    }
+    ++conns_opening;
+    schedule_detached(without_task_context([this] { return open_connection(); }));
+  }
+
+  coro<void> open_connection() {
+    auto now = clock::now();
+    auto conn = co_await create_connection_async();
+    --conns_opening;
+    if (conn) {
+      return_connection(conn, true);
+      co_return;
+    }
+    last_failure = now;
+    // Waiters were only queued in hope of this connection.
+    if (!conns_alive && !conns_opening) {
+      fail_waiters();
+    }
+  }
+
+  void fail_waiters() {
+    while (auto w = pop_waiter()) {
+      w->is_done = true;
+      w->fut.set_exception(
+          std::make_exception_ptr(db_error("could not connect to the database")));
+    }
+  }
+
+  void shrink_pool() {
+    auto above_min = conns_alive - std::min(conns_alive, conns_min);
+    auto excess = std::min({idle_low_watermark, pool.size(), above_min});
+    // Connections at the front are the least recently used ones.
+    pool.erase(pool.begin(), pool.begin() + std::ptrdiff_t(excess));
+    conns_alive -= excess;
+    idle_low_watermark = pool.size();
+  }
+
+  void schedule_shrink() {
+    auto continuation = [this] {
+      shrink_pool();
+      schedule_shrink();
+    };
+    set_timeout(std::make_unique<std::function<void()>>(continuation), SHRINK_INTERVAL);
+  }
+
+  coro<void> probe_lag() {
+    is_probing = true;
+    utils::scope_guard probing_guard([this] { is_probing = false; });
+    raw_connection conn;
+    try {
+      conn = co_await acquire({.prio = priority::HIGH});
+      auto [lag] = (co_await pq::detail::exec(*conn, {LAG_QUERY, nullptr, 0, nullptr, nullptr,
+                                                      nullptr}))
+                       .expect1<double>();
+      bool was_lagging = std::exchange(
+          is_lagging, std::chrono::duration<double>(lag) > max_replica_lag);
+      if (is_lagging && !was_lagging) {
+        logw("Read replica lags behind by {:.1f} s, falling back to the primary", lag);
+      }
+    } catch (db_error const&) {
+      is_lagging = true;
+    }
+    if (conn) {
+      return_connection(conn);
+    }
+  }
+
+  void schedule_lag_probe() {
+    auto continuation = [this] {
+      if (stop_requested) {
+        return;
+      }
+      if (!is_probing) {
+        schedule_detached(without_task_context([this] { return probe_lag(); }));
+      }
+      schedule_lag_probe();
+    };
+    set_timeout(std::make_unique<std::function<void()>>(continuation), LAG_PROBE_INTERVAL);
+  }
+
+  bool is_usable_replica() const {
+    return !stop_requested && !is_lagging && conns_alive;
+  }
+
   impl(creation_info const& info)
       : db_path(info.db_path),
-        conns_desired(info.connections),
-        creation_cooldown(info.creation_cooldown) {
+        conns_min(info.connections),
+        conns_max(std::max(info.connections, info.max_connections)),
+        creation_cooldown(info.creation_cooldown),
+        acquire_timeout(info.acquire_timeout),
+        is_replica(info.is_replica),
+        max_replica_lag(info.max_replica_lag) {
     last_failure = clock::now() - creation_cooldown - std::chrono::seconds(1);
   }
 
+  std::size_t waiters_count() const {
+    std::size_t result = 0;
+    for (auto const& queue : requests) {
+      result += queue.size();
+    }
+    return result;
+  }
+
+  waiter_ptr pop_waiter() {
+    for (auto& queue : requests | std::views::reverse) {
+      if (queue.size()) {
+        auto w = std::move(queue.front());
+        queue.pop_front();
+        return w;
+      }
+    }
+    return {};
+  }
+
   void return_connection(raw_connection conn, bool internal = false) {
     if (stop_requested) {
       return;
     }
-    if (!internal && PQstatus(conn->conn) != CONNECTION_OK) {
+    if (!internal && (PQstatus(conn->conn) != CONNECTION_OK ||
+                      PQpipelineStatus(conn->conn) != PQ_PIPELINE_OFF)) {
       --conns_alive;
-      logw("Connection to the database was lost");
+      logw("Connection to the database was lost or left in a broken state");
       populate_pool();
       return;
     }
-    if (requests.empty()) {
-      pool.push_back(conn);
+    if (auto w = pop_waiter()) {
+      w->is_done = true;
+      w->fut.set_result(conn);
     } else {
-      requests.front()->set_result(conn);
-      requests.pop();
+      pool.push_back(conn);
     }
   }
 
-  void reject_request(future<raw_connection>* req) {
-    req->set_exception(
-        std::make_exception_ptr(std::runtime_error("could not connect to the database")));
+  void expire_waiter(waiter_ptr const& w, priority prio) {
+    if (w->is_done) {
+      return;
+    }
+    auto& queue = requests[std::size_t(prio)];
+    queue.erase(std::find(queue.begin(), queue.end(), w));
+    w->is_done = true;
+    w->fut.set_exception(std::make_exception_ptr(
+        pool_exhausted_error("timed out waiting for a database connection")));
   }
 
-  coro<connection> get_connection(connection_pool* parent) {
-    future<raw_connection> fut;
+  coro<raw_connection> acquire(acquire_options options) {
+    tracing::span span("db.get_connection");
     if (stop_requested) {
-      reject_request(&fut);
-    } else {
-      while (pool.size() && PQstatus(pool.back()->conn) != CONNECTION_OK) {
-        --conns_alive;
-        logw("Connection to the database was lost");
-        pool.pop_back();
-      }
-      if (conns_alive != conns_desired) {
-        populate_pool();
-      }
-      if (!conns_alive) {
-        reject_request(&fut);
-      } else if (pool.empty()) {
-        requests.push(&fut);
-      } else {
-        fut.set_result(pool.back());
-        pool.pop_back();
-      }
+      throw db_error("could not connect to the database");
+    }
+
+    while (pool.size() && PQstatus(pool.back()->conn) != CONNECTION_OK) {
+      --conns_alive;
+      logw("Connection to the database was lost or left in a broken state");
+      pool.pop_back();
+    }
+    if (conns_alive < conns_min) {
+      populate_pool();
+    }
+    if (pool.size()) {
+      auto conn = std::move(pool.back());
+      pool.pop_back();
+      idle_low_watermark = std::min(idle_low_watermark, pool.size());
+      co_return conn;
+    }
+    grow_pool();
+    if (!conns_alive && !conns_opening) {
+      throw db_error("could not connect to the database");
     }
-    co_return {co_await fut, parent};
+
+    // Low priority requests are shed instead of queueing up behind more than a whole pool worth of
+    // waiters, so they do not add latency to the rest.
+    if (options.prio == priority::LOW && waiters_count() >= conns_alive + conns_opening) {
+      throw pool_exhausted_error("database connection pool is saturated");
+    }
+
+    auto w = std::make_shared<waiter>();
+    requests[std::size_t(options.prio)].push_back(w);
+    auto timeout = options.timeout.value_or(acquire_timeout);
+    if (timeout > clock::duration::zero()) {
+      auto on_deadline = [this, weak = std::weak_ptr(w), prio = options.prio] {
+        if (auto alive = weak.lock()) {
+          expire_waiter(alive, prio);
+        }
+      };
+      set_timeout(std::make_unique<std::function<void()>>(on_deadline), timeout);
+    }
+    co_return co_await w->fut;
   }
 
   void on_stop() {
     stop_requested = true;
     pool.clear();
-    while (requests.size()) {
-      reject_request(requests.front());
-      requests.pop();
-    }
+    fail_waiters();
   }
 };
 
 /* ==== async::pq::connection_pool ==== */
 thread_local std::shared_ptr<connection_pool> connection_pool::local;
+thread_local std::vector<std::shared_ptr<connection_pool>> connection_pool::replicas;
 
 void connection_pool::return_connection(raw_connection conn) noexcept {
   pimpl->return_connection(conn);
 }
 
+coro<raw_connection> connection_pool::acquire(acquire_options const& options) {
+  return pimpl->acquire(options);
+}
+
+connection_pool* connection_pool::pick_replica() {
+  connection_pool* best = nullptr;
+  std::size_t best_busy = 0;
+  for (auto const& replica : replicas) {
+    auto const& p = *replica->pimpl;
+    if (!p.is_usable_replica()) {
+      continue;
+    }
+    // Waiters count as busy connections, so an idle replica always wins over a saturated one.
+    auto busy = p.conns_alive - p.pool.size() + p.waiters_count();
+    if (!best || busy < best_busy) {
+      best = replica.get();
+      best_busy = busy;
+    }
+  }
+  return best;
+}
+
 connection_pool::connection_pool(creation_info const& info) {
   pimpl = std::make_unique<impl>(info);
 }
@@ -188,15 +490,28 @@ connection_pool::connection_pool(creation_info const& info) {
 connection_pool::~connection_pool() = default;
 
 void connection_pool::bind_to_thread() {
-  local = std::static_pointer_cast<connection_pool, event_source>(shared_from_this());
+  auto self = std::static_pointer_cast<connection_pool, event_source>(shared_from_this());
+  if (pimpl->is_replica) {
+    replicas.push_back(std::move(self));
+  } else {
+    local = std::move(self);
+  }
 }
 
 void connection_pool::on_init() {
   pimpl->populate_pool();
-  if (pimpl->conns_alive != pimpl->conns_desired) {
-    logw("Could not create pool of {} DB connections (only have {})", pimpl->conns_desired,
+  if (pimpl->conns_alive != pimpl->conns_min) {
+    logw("Could not create pool of {} DB connections (only have {})", pimpl->conns_min,
          pimpl->conns_alive);
   }
+  pimpl->is_initialized = true;
+  pimpl->idle_low_watermark = pimpl->pool.size();
+  if (pimpl->conns_max > pimpl->conns_min) {
+    pimpl->schedule_shrink();
+  }
+  if (pimpl->is_replica) {
+    pimpl->schedule_lag_probe();
+  }
 }
 
 void connection_pool::on_stop() {
@@ -204,7 +519,26 @@ void connection_pool::on_stop() {
 }
 
 coro<connection> connection_pool::get_connection() {
-  return pimpl->get_connection(this);
+  return get_connection({});
+}
+
+coro<connection> connection_pool::get_connection(acquire_options const& options) {
+  co_return {co_await acquire(options), this};
+}
+
+connection connection_pool::get_lazy_connection() {
+  return {this, {}};
+}
+
+connection connection_pool::get_lazy_connection(acquire_options const& options) {
+  return {this, options};
+}
+
+connection_pool::stats connection_pool::get_stats() const {
+  return {.alive = pimpl->conns_alive,
+          .idle = pimpl->pool.size(),
+          .waiters = pimpl->waiters_count(),
+          .reconnects = pimpl->reconnects};
 }
 
 /* ==== async::pq::result ==== */
@@ -230,15 +564,11 @@ void result::expect0() const {
 }
 
 /* ==== async::pq::detail ==== */
-coro<result> pq::detail::exec(connection_storage& c, char const* command, int size,
-                              char const* values[], int lengths[], int formats[]) {
+namespace {
+coro<void> flush_connection(connection_storage& c) {
   c.sock.event_mask = SOCK_ALL;
   libev_event_loop::get()->socket_mod(&c.sock);
 
-  if (!PQsendQueryParams(c.conn, command, size, nullptr, values, lengths, formats, 1)) {
-    throw pq::db_error(PQerrorMessage(c.conn));
-  }
-
   while (true) {
     int result = PQflush(c.conn);
     assert(result != -1);
@@ -255,14 +585,20 @@ coro<result> pq::detail::exec(connection_storage& c, char const* command, int si
 
   c.sock.event_mask = READABLE;
   libev_event_loop::get()->socket_mod(&c.sock);
+}
 
+coro<void> wait_for_result(connection_storage& c) {
   while (PQisBusy(c.conn)) {
     co_await socket_performer{READABLE, &c.sock};
     assert(PQconsumeInput(c.conn));
   }
+}
 
+// Returns the last result of the current query, or nullptr if there are none.
+coro<PGresult*> collect_results(connection_storage& c) {
   PGresult* latest = nullptr;
   while (true) {
+    co_await wait_for_result(c);
     auto curr = PQgetResult(c.conn);
     if (!curr) {
       break;
@@ -271,7 +607,197 @@ coro<result> pq::detail::exec(connection_storage& c, char const* command, int si
     }
     latest = curr;
   }
-  co_return {latest};
+  co_return latest;
+}
+
+bool needs_preparation(connection_storage& c, pq::detail::lowered_query const& q) {
+  return q.name && !c.prepared.contains(q.name);
+}
+
+// Leaves the pipeline mode however the pipeline ends. It cannot be left while results are still
+// pending, in which case the connection is dropped once it is returned to the pool.
+struct pipeline_guard {
+  PGconn* conn;
+
+  ~pipeline_guard() {
+    PQexitPipelineMode(conn);
+  }
+};
+
+using owned_result = std::unique_ptr<PGresult, decltype(&PQclear)>;
+
+int send_query(connection_storage& c, pq::detail::lowered_query const& q) {
+  if (q.name) {
+    return PQsendQueryPrepared(c.conn, q.name, q.size, q.values, q.lengths, q.formats, 1);
+  } else {
+    return PQsendQueryParams(c.conn, q.command, q.size, nullptr, q.values, q.lengths, q.formats,
+                             1);
+  }
+}
+}  // namespace
+
+coro<result> pq::detail::exec(connection_storage& c, lowered_query const& q) {
+  tracing::span span("db.exec", q.name ? q.name : q.command);
+  if (needs_preparation(c, q)) {
+    if (!PQsendPrepare(c.conn, q.name, q.command, 0, nullptr)) {
+      throw pq::db_error(PQerrorMessage(c.conn));
+    }
+    co_await flush_connection(c);
+    result{co_await collect_results(c)};
+    c.prepared.insert(q.name);
+  }
+
+  if (!send_query(c, q)) {
+    throw pq::db_error(PQerrorMessage(c.conn));
+  }
+  co_await flush_connection(c);
+  co_return {co_await collect_results(c)};
+}
+
+coro<std::size_t> pq::detail::copy(connection_storage& c, char const* command,
+                                   std::function<bool(copy_encoder&)> const& fill) {
+  tracing::span span("db.copy", command);
+  if (!PQsendQuery(c.conn, command)) {
+    throw pq::db_error(PQerrorMessage(c.conn));
+  }
+  co_await flush_connection(c);
+  co_await wait_for_result(c);
+  auto started = PQgetResult(c.conn);
+  if (PQresultStatus(started) != PGRES_COPY_IN) {
+    // Results must be drained, so the connection can be reused.
+    PQclear(co_await collect_results(c));
+    result{started};
+    throw pq::db_error("expected COPY FROM STDIN command");
+  }
+  PQclear(started);
+
+  // The copy should be ended even if encoding fails, otherwise the connection stays stuck in it.
+  std::exception_ptr error;
+  copy_encoder out;
+  bool has_more = true;
+  while (has_more && !error) {
+    try {
+      has_more = fill(out);
+      if (!has_more) {
+        out.finish();
+      }
+    } catch (...) {
+      error = std::current_exception();
+      break;
+    }
+    auto chunk = out.take();
+    while (true) {
+      int sent = PQputCopyData(c.conn, chunk.data(), int(chunk.size()));
+      if (sent == -1) {
+        throw pq::db_error(PQerrorMessage(c.conn));
+      } else if (sent == 1) {
+        break;
+      }
+      co_await flush_connection(c);
+    }
+  }
+
+  while (true) {
+    int ended = PQputCopyEnd(c.conn, error ? "aborted by the client" : nullptr);
+    if (ended == -1) {
+      throw pq::db_error(PQerrorMessage(c.conn));
+    } else if (ended == 1) {
+      break;
+    }
+    co_await flush_connection(c);
+  }
+  co_await flush_connection(c);
+  auto finished = co_await collect_results(c);
+  if (error) {
+    PQclear(finished);
+    std::rethrow_exception(error);
+  }
+  auto rows = std::strtoull(PQcmdTuples(finished), nullptr, 10);
+  result{finished};
+  co_return rows;
+}
+
+coro<std::vector<result>> pq::detail::exec_pipeline(connection_storage& c,
+                                                    lowered_query const* queries,
+                                                    std::size_t count) {
+  tracing::span span("db.exec_pipeline");
+  if (!PQenterPipelineMode(c.conn)) {
+    throw pq::db_error(PQerrorMessage(c.conn));
+  }
+  pipeline_guard guard{c.conn};
+  // Preparations are sent in the same pipeline right before the corresponding query.
+  std::vector<bool> sends_preparation(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    auto const& q = queries[i];
+    if (needs_preparation(c, q) &&
+        std::ranges::none_of(queries, queries + i, [&](auto const& other) {
+          return other.name && std::string_view(other.name) == q.name;
+        })) {
+      if (!PQsendPrepare(c.conn, q.name, q.command, 0, nullptr)) {
+        throw pq::db_error(PQerrorMessage(c.conn));
+      }
+      sends_preparation[i] = true;
+    }
+    if (!send_query(c, q)) {
+      throw pq::db_error(PQerrorMessage(c.conn));
+    }
+  }
+  if (!PQpipelineSync(c.conn)) {
+    throw pq::db_error(PQerrorMessage(c.conn));
+  }
+  co_await flush_connection(c);
+
+  // Results must be drained up to the sync point even if some query failed, otherwise the
+  // connection cannot be returned to the pool.
+  std::vector<owned_result> raw;
+  raw.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    if (sends_preparation[i]) {
+      owned_result prepare_result{co_await collect_results(c), PQclear};
+      if (PQresultStatus(prepare_result.get()) == PGRES_COMMAND_OK) {
+        c.prepared.insert(queries[i].name);
+      }
+    }
+    raw.emplace_back(co_await collect_results(c), PQclear);
+  }
+
+  co_await wait_for_result(c);
+  owned_result sync{PQgetResult(c.conn), PQclear};
+  assert(PQresultStatus(sync.get()) == PGRES_PIPELINE_SYNC);
+
+  // Failed results are only thrown after the whole pipeline has been drained.
+  std::vector<result> results;
+  results.reserve(count);
+  for (auto& r : raw) {
+    results.emplace_back(r.release());
+  }
+  co_return results;
+}
+
+/* ==== async::pq::detail::copy_encoder ==== */
+pq::detail::copy_encoder::copy_encoder() {
+  static constexpr char SIGNATURE[] = "PGCOPY\n\377\r\n";
+  buff.append(SIGNATURE, sizeof(SIGNATURE));  // including the trailing zero byte
+  put_int32(0);                               // flags
+  put_int32(0);                               // length of the header extension
+}
+
+void pq::detail::copy_encoder::put_int16(int16_t value) {
+  uint16_t to_write = htobe16(static_cast<uint16_t>(value));
+  buff.append(reinterpret_cast<char*>(&to_write), 2);
+}
+
+void pq::detail::copy_encoder::put_int32(int32_t value) {
+  uint32_t to_write = htobe32(static_cast<uint32_t>(value));
+  buff.append(reinterpret_cast<char*>(&to_write), 4);
+}
+
+void pq::detail::copy_encoder::finish() {
+  put_int16(-1);
+}
+
+std::string pq::detail::copy_encoder::take() {
+  return std::exchange(buff, {});
 }
 
 /* ==== Decoders for PQ binary format ==== */
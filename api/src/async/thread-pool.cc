@@ -0,0 +1,140 @@
+#include "async/thread-pool.h"
+
+#include "async/future.h"
+#include "async/tracing.h"
+using namespace async;
+
+namespace {
+// Items are split into about this many chunks per thread, so threads which got slower items are
+// helped by the rest.
+constexpr std::size_t CHUNKS_PER_THREAD = 4;
+
+struct batch {
+  std::function<void(std::size_t)> func;
+  std::size_t count, chunk;
+  std::atomic<std::size_t> next = 0;
+  // Threads which have not finished with the batch yet
+  std::atomic<std::size_t> participants;
+
+  std::atomic<bool> failed = false;
+  std::mutex error_lock;
+  std::exception_ptr error;
+
+  // Only touched in the thread of the loop
+  std::shared_ptr<event_loop> loop;
+  future<void> done;
+
+  void run_chunks() {
+    for (auto start = next.fetch_add(chunk); start < count; start = next.fetch_add(chunk)) {
+      for (auto i = start; i < std::min(start + chunk, count) && !failed; ++i) {
+        try {
+          func(i);
+        } catch (...) {
+          std::lock_guard guard(error_lock);
+          if (!failed.exchange(true)) {
+            error = std::current_exception();
+          }
+        }
+      }
+    }
+  }
+
+  static void finish(std::shared_ptr<batch> const& b) {
+    b->loop->post([b] {
+      if (b->error) {
+        b->done.set_exception(b->error);
+      } else {
+        b->done.set_result();
+      }
+    });
+  }
+};
+
+using batch_ptr = std::shared_ptr<batch>;
+
+class thread_pool {
+private:
+  std::mutex lock;
+  std::condition_variable has_work;
+  // A batch is queued once per thread which should take part in it.
+  std::deque<batch_ptr> queue;
+  bool stop_requested = false;
+  std::vector<std::thread> threads;
+
+  void work() {
+    while (true) {
+      batch_ptr b;
+      {
+        std::unique_lock guard(lock);
+        has_work.wait(guard, [this] { return stop_requested || queue.size(); });
+        if (queue.empty()) {
+          return;
+        }
+        b = std::move(queue.front());
+        queue.pop_front();
+      }
+      b->run_chunks();
+      if (--b->participants == 0) {
+        batch::finish(b);
+      }
+    }
+  }
+
+public:
+  thread_pool() {
+    auto count = std::max(1U, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < count; ++i) {
+      threads.emplace_back([this] { work(); });
+    }
+  }
+
+  ~thread_pool() {
+    {
+      std::lock_guard guard(lock);
+      stop_requested = true;
+    }
+    has_work.notify_all();
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+
+  std::size_t size() const {
+    return threads.size();
+  }
+
+  void submit(batch_ptr const& b, std::size_t participants) {
+    b->participants = participants;
+    {
+      std::lock_guard guard(lock);
+      for (std::size_t i = 0; i < participants; ++i) {
+        queue.push_back(b);
+      }
+    }
+    has_work.notify_all();
+  }
+};
+
+// Threads are only started by the first parallel_for.
+thread_pool& get_pool() {
+  static thread_pool pool;
+  return pool;
+}
+}  // namespace
+
+coro<void> async::parallel_for(std::size_t count, std::function<void(std::size_t)> func) {
+  if (!count) {
+    co_return;
+  }
+  tracing::span span("parallel_for");
+  auto& pool = get_pool();
+
+  auto b = std::make_shared<batch>();
+  b->func = std::move(func);
+  b->count = count;
+  b->chunk = std::max<std::size_t>(1, count / (pool.size() * CHUNKS_PER_THREAD));
+  b->loop = event_loop::local;
+
+  pool.submit(b, std::min(pool.size(), (count + b->chunk - 1) / b->chunk));
+  co_await b->done;
+}
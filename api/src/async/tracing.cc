@@ -0,0 +1,85 @@
+#include "async/tracing.h"
+using namespace async;
+using namespace tracing;
+
+namespace {
+// Long SQL commands would make dumps unreadable
+constexpr std::size_t MAX_DETAIL_LENGTH = 80;
+
+double to_ms(clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+}  // namespace
+
+/* ==== async::tracing::trace ==== */
+trace* trace::get() {
+  return static_cast<trace*>(get_task_context());
+}
+
+int trace::open(char const* name, std::string_view detail) {
+  // SQL commands are usually indented over multiple lines
+  std::string stored;
+  for (char c : detail) {
+    if (stored.size() == MAX_DETAIL_LENGTH) {
+      break;
+    }
+    if (!std::isspace(static_cast<unsigned char>(c))) {
+      stored += c;
+    } else if (!stored.empty() && stored.back() != ' ') {
+      stored += ' ';
+    }
+  }
+  spans.push_back({name, std::move(stored), current, clock::now(), {}});
+  return current = int(spans.size() - 1);
+}
+
+void trace::close(int id) {
+  auto& record = spans[id];
+  record.end = clock::now();
+  if (current == id) {
+    current = record.parent;
+  }
+}
+
+std::string trace::format() const {
+  std::vector<std::vector<int>> children(spans.size() + 1);
+  for (int i = 0; i < int(spans.size()); ++i) {
+    children[spans[i].parent + 1].push_back(i);
+  }
+
+  std::string result;
+  auto out = std::back_inserter(result);
+  auto dump = [&](auto& self, int id, int depth) -> void {
+    auto const& record = spans[id];
+    fmt::format_to(out, "{:{}}{}", "", 2 * depth, record.name);
+    if (!record.detail.empty()) {
+      fmt::format_to(out, " [{}]", record.detail);
+    }
+    if (record.end == clock::time_point{}) {
+      fmt::format_to(out, ": unfinished");
+    } else {
+      fmt::format_to(out, ": {:.3f} ms", to_ms(record.end - record.start));
+    }
+    fmt::format_to(out, " (at +{:.3f} ms)\n", to_ms(record.start - start));
+    for (int child : children[id + 1]) {
+      self(self, child, depth + 1);
+    }
+  };
+  for (int root : children[0]) {
+    dump(dump, root, 0);
+  }
+  return result;
+}
+
+/* ==== async::tracing::span ==== */
+span::span(char const* name, std::string_view detail) : owner(trace::get()) {
+  if (owner) {
+    id = owner->open(name, detail);
+  }
+}
+
+span::~span() {
+  if (owner) {
+    owner->close(id);
+  }
+}
@@ -0,0 +1,129 @@
+#include "async/work-stealing.h"
+using namespace async;
+
+/* ==== async::work_stealing_pool ==== */
+thread_local work_stealing_pool::worker_state* work_stealing_pool::local = nullptr;
+
+work_stealing_pool::work_stealing_pool(std::size_t workers_count, std::size_t threshold_)
+    : threshold(threshold_) {
+  for (std::size_t i = 0; i < workers_count; ++i) {
+    workers.push_back(std::make_unique<worker_state>());
+  }
+}
+
+std::shared_ptr<event_source> work_stealing_pool::make_worker(std::size_t id) {
+  return std::make_shared<worker>(shared_from_this(), workers.at(id).get());
+}
+
+std::optional<work_stealing_pool::job> work_stealing_pool::take(worker_state& w) {
+  {
+    std::lock_guard guard(w.lock);
+    if (w.queue.size()) {
+      auto result = std::move(w.queue.front());
+      w.queue.pop_front();
+      --event_loop::local->alive_coroutines;
+      return result;
+    }
+  }
+
+  // Steal the oldest job of the worker with the longest queue
+  worker_state* victim = nullptr;
+  std::size_t victim_queue = 0;
+  for (auto const& other : workers) {
+    if (other.get() == &w) {
+      continue;
+    }
+    std::lock_guard guard(other->lock);
+    if (other->queue.size() > victim_queue) {
+      victim = other.get();
+      victim_queue = other->queue.size();
+    }
+  }
+  if (!victim) {
+    return std::nullopt;
+  }
+
+  std::lock_guard guard(victim->lock);
+  if (victim->queue.empty()) {
+    return std::nullopt;
+  }
+  auto result = std::move(victim->queue.front());
+  victim->queue.pop_front();
+  // The counter of the victim's loop is only touched in its own thread.
+  victim->loop->post([] { --event_loop::local->alive_coroutines; });
+  return result;
+}
+
+coro<void> work_stealing_pool::run(worker_state& w, job j) {
+  ++w.in_progress;
+  try {
+    co_await j();
+  } catch (...) {
+    --w.in_progress;
+    fill(w);
+    throw;
+  }
+  --w.in_progress;
+  fill(w);
+}
+
+void work_stealing_pool::fill(worker_state& w) {
+  while (w.in_progress < threshold) {
+    auto next = take(w);
+    if (!next) {
+      break;
+    }
+    schedule_detached(run(w, std::move(*next)));
+  }
+}
+
+void work_stealing_pool::submit(job j) {
+  assert(local);
+  auto& w = *local;
+
+  if (w.in_progress < threshold) {
+    schedule_detached(run(w, std::move(j)));
+    return;
+  }
+
+  {
+    std::lock_guard guard(w.lock);
+    w.queue.push_back(std::move(j));
+  }
+  // Queued jobs keep the loop alive, so it does not stop (dropping them) until they are taken by
+  // this or another loop.
+  ++event_loop::local->alive_coroutines;
+
+  for (auto const& other : workers) {
+    if (other.get() == &w || other->in_progress >= threshold) {
+      continue;
+    }
+    std::shared_ptr<event_loop> thief_loop;
+    {
+      std::lock_guard guard(other->lock);
+      thief_loop = other->loop;
+    }
+    // The loop might not have been started yet
+    if (thief_loop) {
+      auto self = shared_from_this();
+      auto thief = other.get();
+      thief_loop->post([self, thief] { self->fill(*thief); });
+      break;
+    }
+  }
+}
+
+/* ==== async::work_stealing_pool::worker ==== */
+work_stealing_pool::worker::worker(std::shared_ptr<work_stealing_pool> pool_,
+                                   worker_state* state_)
+    : pool(std::move(pool_)), state(state_) {}
+
+void work_stealing_pool::worker::bind_to_thread() {
+  local = state;
+}
+
+void work_stealing_pool::worker::on_init() {
+  // Sources are bound before the loop itself, so the loop is only known here.
+  std::lock_guard guard(state->lock);
+  state->loop = event_loop::local;
+}
@@ -16,12 +16,27 @@ void config::from_json(json const& j, hl_socket_address& obj) {
   }
 }
 
+void config::from_json(json const& j, db_info_t& obj) {
+  j.at("path").get_to(obj.path);
+  j.at("connections").get_to(obj.connections);
+  obj.max_connections = j.value("max_connections", obj.connections);
+  j.at("cooldown").get_to(obj.cooldown);
+  obj.acquire_timeout = j.value("acquire_timeout", 0LL);
+  obj.replicas = j.value("replicas", std::vector<std::string>{});
+  obj.replica_max_lag = j.value("replica_max_lag", 1000LL);
+}
+
 void config::from_json(json const& j, config_t& obj) {
   j.at("workers").get_to(obj.request_workers);
   j.at("files_dir").get_to(obj.files_dir);
+  if (j.contains("files_accel_redirect")) {
+    j.at("files_accel_redirect").get_to(obj.files_accel_redirect);
+  }
   j.at("api_root").get_to(obj.api_root);
   j.at("fastcgi").get_to(obj.fastcgi);
   j.at("db").get_to(obj.db);
+  obj.persistent_sessions = j.value("persistent_sessions", false);
+  obj.slow_request_threshold = j.value("slow_request_threshold", 0LL);
 }
 
 config_t config::find_config(std::filesystem::path const& path) {
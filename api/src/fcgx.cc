@@ -61,6 +61,7 @@ void request_streambuf::set_request(request_t* request_) {
 
 /* ==== fcgx::request_t ==== */
 void request_t::finish() {
+  end_body_stream();
   if (!is_meta_fixed) {
     fix_meta();
   }
@@ -127,56 +128,70 @@ coro<int> fcgx_async_read_str(char* str, int n, FCGX_Stream* stream, socket_stor
 #endif
 }  // namespace
 
+/* ==== fcgx::listener ==== */
+listener::listener(config::hl_socket_address const& addr, int queue_size) {
+  if (addr.use_unix_sockets) {
+    fd = FCGX_OpenSocket(addr.path.c_str(), queue_size);
+    utils::ensure(fd < 0, "socket creation failed");
+    if (addr.perms != -1) {
+      utils::ensure(chmod(addr.path.c_str(), addr.perms),
+                    "changing socket file permissions failed");
+    }
+    utils::ensure(fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) == -1,
+                  "making socket non blocking failed");
+  } else {
+    std::string port_str = std::to_string(addr.port);
+    std::string sock_id = addr.path + ":" + port_str;
+    addrinfo* result;
+    utils::ensure(getaddrinfo(addr.path.c_str(), port_str.c_str(), 0, &result),
+                  "getaddrinfo for " + sock_id + " failed");
+    utils::scope_guard result_guard([&] { freeaddrinfo(result); });
+
+    for (addrinfo* it = result; it; it = it->ai_next) {
+      fd = socket(it->ai_family, it->ai_socktype | SOCK_NONBLOCK, it->ai_protocol);
+      if (fd < 0) {
+        continue;
+      }
+      int optval = 1;
+      utils::ensure(setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)),
+                    "setting SO_REUSEPORT on FCGX socket failed");
+      utils::ensure(bind(fd, it->ai_addr, it->ai_addrlen), "binding socket failed");
+      break;
+    }
+    utils::ensure(fd < 0, "out of options to bind socket to " + sock_id);
+    utils::ensure(listen(fd, queue_size), "listen failed");
+  }
+}
+
+listener::~listener() {
+  close(fd);
+}
+
+int listener::get_fd() const {
+  return fd;
+}
+
 /* ==== fcgx::server::impl ==== */
 /** @private */
 struct server::impl {
+  std::shared_ptr<listener> socket;
   int fd;
+  // Whether other workers accept connections from the same socket.
+  bool is_shared;
   std::function<void(FCGX_Request*)> handler;
   ev_loop_t* loop;
   ev_with_arg<ev_io> accept_ev;
   FCGX_Request* req;
 
-  impl(config::hl_socket_address const& addr, int queue_size,
+  impl(std::shared_ptr<listener> socket_, bool is_shared_,
        std::function<void(FCGX_Request*)> const& handler_)
-      : handler(handler_) {
+      : socket(std::move(socket_)), fd(socket->get_fd()), is_shared(is_shared_), handler(handler_) {
     req = new FCGX_Request;
-    if (addr.use_unix_sockets) {
-      fd = FCGX_OpenSocket(addr.path.c_str(), queue_size);
-      utils::ensure(fd < 0, "socket creation failed");
-      if (addr.perms != -1) {
-        utils::ensure(chmod(addr.path.c_str(), addr.perms),
-                      "changing socket file permissions failed");
-      }
-      utils::ensure(fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) == -1,
-                    "making socket non blocking failed");
-    } else {
-      std::string port_str = std::to_string(addr.port);
-      std::string sock_id = addr.path + ":" + port_str;
-      addrinfo* result;
-      utils::ensure(getaddrinfo(addr.path.c_str(), port_str.c_str(), 0, &result),
-                    "getaddrinfo for " + sock_id + " failed");
-      utils::scope_guard result_guard([&] { freeaddrinfo(result); });
-
-      for (addrinfo* it = result; it; it = it->ai_next) {
-        fd = socket(it->ai_family, it->ai_socktype | SOCK_NONBLOCK, it->ai_protocol);
-        if (fd < 0) {
-          continue;
-        }
-        int optval = 1;
-        utils::ensure(setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)),
-                      "setting SO_REUSEPORT on FCGX socket failed");
-        utils::ensure(bind(fd, it->ai_addr, it->ai_addrlen), "binding socket failed");
-        break;
-      }
-      utils::ensure(fd < 0, "out of options to bind socket to " + sock_id);
-      utils::ensure(listen(fd, queue_size), "listen failed");
-    }
   }
 
   ~impl() {
     ev_io_stop(loop, &accept_ev.w);
     delete req;
-    close(fd);
   }
 
   static void accept_cb(ev_loop_t*, ev_io* w, int) {
@@ -189,6 +204,11 @@ struct server::impl {
       }
       p->handler(p->req);
       p->req = new FCGX_Request;
+      // Let the others take the rest of the backlog. The watcher is level-triggered, so we will be
+      // woken up again if nobody does.
+      if (p->is_shared) {
+        break;
+      }
     }
   }
 
@@ -204,7 +224,12 @@ struct server::impl {
 /* ==== fcgx::server ==== */
 server::server(config::hl_socket_address const& addr, int queue_size,
                std::function<void(FCGX_Request*)> const& handler) {
-  pimpl = new impl{addr, queue_size, handler};
+  pimpl = new impl{std::make_shared<listener>(addr, queue_size), false, handler};
+}
+
+server::server(std::shared_ptr<listener> socket,
+               std::function<void(FCGX_Request*)> const& handler) {
+  pimpl = new impl{std::move(socket), true, handler};
 }
 
 void server::on_init() {
@@ -231,23 +256,32 @@ coro<request_t*> fcgx::from_raw(FCGX_Request* raw) {
 
   body_type_t body_type = BODY_UNINITIALIZED;
   json body;
-  std::string data, raw_body;
+  std::string raw_body;
 
   char* mime_type = FCGX_GetParam("HTTP_CONTENT_TYPE", raw->envp);
+  char* content_length_str = FCGX_GetParam("CONTENT_LENGTH", raw->envp);
+
+  std::size_t content_length = 0;
+  if (content_length_str) {
+    std::from_chars(content_length_str, content_length_str + strlen(content_length_str),
+                    content_length);
+  }
 
   int const FCGX_CHUNK_SIZE = 8192;
+  std::size_t const MAX_BODY_PRESIZE = 1 << 20;
   char chunk[FCGX_CHUNK_SIZE];
   std::size_t clen;
 
 #if defined(KEGE_FCGI_USE_ASYNC) && KEGE_FCGI_USE_ASYNC
-#  define READ_CHUNK (clen = co_await fcgx_async_read_str(chunk, FCGX_CHUNK_SIZE, raw->in, storage))
+#  define READ_INTO(buf, n) (co_await fcgx_async_read_str(buf, n, raw->in, storage))
 
   socket_storage storage;
   fcgx_setnonblocking(raw, storage);
 
 #else
-#  define READ_CHUNK (clen = FCGX_GetStr(chunk, FCGX_CHUNK_SIZE, raw->in))
+#  define READ_INTO(buf, n) (FCGX_GetStr(buf, n, raw->in))
 #endif
+#define READ_CHUNK (clen = READ_INTO(chunk, FCGX_CHUNK_SIZE))
 
   try {
     if (mime_type && is_mime_type(mime_type, "application/x-www-form-urlencoded")) {
@@ -273,34 +307,57 @@ coro<request_t*> fcgx::from_raw(FCGX_Request* raw) {
       }
       body_type = BODY_FORM_URL;
 
-    } else if (mime_type && is_mime_type(mime_type, "application/json")) {
-      /* Body is a JSON object */
-      while (READ_CHUNK) {
-        data += std::string_view(chunk, clen);
-      }
+    } else if (mime_type && is_mime_type(mime_type, "application/octet-stream")) {
+      /* Body is left in the stream for the route to consume */
+      body_type = BODY_STREAM;
 
-      try {
-        body = json::parse(data);
-        body_type = BODY_JSON;
-      } catch (std::exception const& e) {
-        body["_err"] = e.what();
-        raw_body = data;
-        body_type = BODY_DECODE_ERROR;
-      } catch (...) {
-        body["_err"] = "unknown error";
-        raw_body = data;
-        body_type = BODY_DECODE_ERROR;
-      }
-    }
+    } else {
+      /* Body is read directly into raw_body, which is pre-sized from CONTENT_LENGTH. Bodies can
+       * be as large as 2G (see meta/nginx/nginx.conf), so no intermediate copies are made. The
+       * header is not trusted beyond MAX_BODY_PRESIZE, larger bodies grow the buffer as they
+       * arrive. */
+      raw_body.resize(std::min(content_length, MAX_BODY_PRESIZE));
+      std::size_t size = 0;
+      while (true) {
+        if (size == raw_body.size()) {
+          // Either CONTENT_LENGTH was not passed or the buffer is exhausted. In the latter case,
+          // this is the check for the end of the stream.
+          if (!READ_CHUNK) {
+            break;
+          }
+          raw_body.resize(std::max(2 * size, size + clen));
+          std::memcpy(raw_body.data() + size, chunk, clen);
+          size += clen;
+          continue;
+        }
 
-    if (body_type == BODY_UNINITIALIZED) {
-      /* Body is plaintext */
-      while (READ_CHUNK) {
-        data += std::string_view(chunk, clen);
+        int to_read = (int) std::min<std::size_t>(raw_body.size() - size, INT_MAX);
+        if (!(clen = READ_INTO(raw_body.data() + size, to_read))) {
+          break;
+        }
+        size += clen;
+      }
+      raw_body.resize(size);
+
+      if (mime_type && is_mime_type(mime_type, "application/json")) {
+        /* Body is a JSON object */
+        try {
+          body = json::parse(raw_body);
+          body_type = BODY_JSON;
+          // Routes only use the parsed value.
+          std::string().swap(raw_body);
+        } catch (std::exception const& e) {
+          body["_err"] = e.what();
+          body_type = BODY_DECODE_ERROR;
+        } catch (...) {
+          body["_err"] = "unknown error";
+          body_type = BODY_DECODE_ERROR;
+        }
+      } else {
+        /* Body is plaintext */
+        body.clear();
+        body_type = BODY_PLAIN_TEXT;
       }
-      body.clear();
-      raw_body = data;
-      body_type = BODY_PLAIN_TEXT;
     }
   } catch (...) {
     body.clear();
@@ -308,6 +365,7 @@ coro<request_t*> fcgx::from_raw(FCGX_Request* raw) {
   }
 
 #undef READ_CHUNK
+#undef READ_INTO
 #if defined(KEGE_FCGI_USE_ASYNC) && KEGE_FCGI_USE_ASYNC
   fcgx_setnonblocking(raw, storage, false);
 #endif
@@ -339,3 +397,31 @@ coro<request_t*> fcgx::from_raw(FCGX_Request* raw) {
 
   co_return r;
 }
+
+coro<std::size_t> request_t::read_body(char* buffer, std::size_t size) {
+  assert(body_type == BODY_STREAM);
+  int to_read = (int) std::min<std::size_t>(size, INT_MAX);
+#if defined(KEGE_FCGI_USE_ASYNC) && KEGE_FCGI_USE_ASYNC
+  // Socket is switched to non-blocking mode once per body rather than around every chunk.
+  if (!body_socket) {
+    body_socket = std::make_unique<socket_storage>();
+    fcgx_setnonblocking(raw, *body_socket);
+  }
+  int result = co_await fcgx_async_read_str(buffer, to_read, raw->in, *body_socket);
+  if (!result) {
+    end_body_stream();
+  }
+  co_return (std::size_t) result;
+#else
+  co_return (std::size_t) FCGX_GetStr(buffer, to_read, raw->in);
+#endif
+}
+
+void request_t::end_body_stream() {
+#if defined(KEGE_FCGI_USE_ASYNC) && KEGE_FCGI_USE_ASYNC
+  if (body_socket) {
+    fcgx_setnonblocking(raw, *body_socket, false);
+    body_socket.reset();
+  }
+#endif
+}
@@ -8,7 +8,10 @@
 #include "async/curl.h"
 #include "async/libev-event-loop.h"
 #include "async/pq.h"
+#include "async/work-stealing.h"
 #include "routes.h"
+#include "routes/metrics.h"
+#include "routes/session.h"
 #include "stacktrace.h"
 
 // routes/_wrap.cc
@@ -32,6 +35,12 @@ void interrupt_handler(int, siginfo_t*, void*) noexcept {
   }
 }
 
+// Unix sockets do not balance connections with SO_REUSEPORT, so unless the path contains "{id}",
+// all workers accept from a single socket.
+bool uses_shared_socket(config::hl_socket_address const& addr) {
+  return addr.use_unix_sockets && addr.path.find("{id}") == std::string::npos;
+}
+
 config::hl_socket_address socket_address_apply_id(config::hl_socket_address addr, std::size_t id) {
   if (!addr.use_unix_sockets) {
     return addr;
@@ -71,6 +80,15 @@ int main() {
     conf = config::find_config(kege_root ? kege_root : ".");
   }
   routes::route_storage::instance().build(conf.api_root);
+  routes::metrics::init(routes::route_storage::instance().get_route_names());
+  if (conf.persistent_sessions) {
+    // Users will just have to log in again, which is better than not starting at all.
+    try {
+      routes::session::restore(conf.db.path);
+    } catch (std::exception const& e) {
+      loge("Failed to restore sessions: {}", e.what());
+    }
+  }
 
   assert(!FCGX_Init());
   assert(!curl_global_init(CURL_GLOBAL_DEFAULT));
@@ -98,16 +116,45 @@ int main() {
   async::pq::connection_pool::creation_info pq_creation_info = {
       .db_path = conf.db.path,
       .connections = conf.db.connections,
-      .creation_cooldown = std::chrono::milliseconds(conf.db.cooldown)};
+      .max_connections = conf.db.max_connections,
+      .creation_cooldown = std::chrono::milliseconds(conf.db.cooldown),
+      .acquire_timeout = std::chrono::milliseconds(conf.db.acquire_timeout)};
+  std::vector<async::pq::connection_pool::creation_info> replica_creation_infos;
+  for (auto const& replica : conf.db.replicas) {
+    auto& info = replica_creation_infos.emplace_back(pq_creation_info);
+    info.db_path = replica;
+    info.is_replica = true;
+    info.max_replica_lag = std::chrono::milliseconds(conf.db.replica_max_lag);
+  }
+
+  std::shared_ptr<fcgx::listener> shared_socket;
+  if (uses_shared_socket(conf.fastcgi)) {
+    shared_socket = std::make_shared<fcgx::listener>(conf.fastcgi, FCGI_QUEUE_SIZE);
+  }
+
+  auto balancer = std::make_shared<async::work_stealing_pool>(conf.request_workers,
+                                                              WORK_STEALING_THRESHOLD);
 
   for (std::size_t worker = 0; worker < conf.request_workers; ++worker) {
     auto& data = workers[worker];
     data.loop = std::make_shared<async::libev_event_loop>();
     data.loop->register_source(std::make_shared<async::curl_event_source>());
     data.loop->register_source(std::make_shared<async::pq::connection_pool>(pq_creation_info));
-    data.loop->register_source(std::make_shared<fcgx::server>(
-        socket_address_apply_id(conf.fastcgi, worker), FCGI_QUEUE_SIZE,
-        [](FCGX_Request* raw) { schedule_detached(perform_request_wrap(raw)); }));
+    for (auto const& info : replica_creation_infos) {
+      data.loop->register_source(std::make_shared<async::pq::connection_pool>(info));
+    }
+    data.loop->register_source(std::make_shared<routes::session_gc>());
+    data.loop->register_source(std::make_shared<routes::metrics::collector>(worker));
+    data.loop->register_source(balancer->make_worker(worker));
+    auto handler = [balancer](FCGX_Request* raw) {
+      balancer->submit([raw] { return perform_request_wrap(raw); });
+    };
+    if (shared_socket) {
+      data.loop->register_source(std::make_shared<fcgx::server>(shared_socket, handler));
+    } else {
+      data.loop->register_source(std::make_shared<fcgx::server>(
+          socket_address_apply_id(conf.fastcgi, worker), FCGI_QUEUE_SIZE, handler));
+    }
   }
 
   for (std::size_t worker = 0; worker < conf.request_workers; ++worker) {
@@ -130,5 +177,8 @@ int main() {
   for (std::size_t id = 0; id < conf.request_workers; ++id) {
     workers[id].t.join();
   }
+
+  auto frames = async::get_frame_allocator_stats();
+  logi("Coroutine frames: {} allocated, {} reused", frames.allocated, frames.reused);
   fmtlog::poll();
 }
@@ -8,6 +8,7 @@ public:
   struct node {
     std::map<std::string, std::unique_ptr<node>, std::less<>> go;
     route_t current = nullptr;
+    std::size_t id = 0;
     std::unique_ptr<std::pair<std::string, node>> var;
   };
 
@@ -47,7 +48,7 @@ public:
 
   route_t fallback = 0;
 
-  void insert_path(std::string const& path, route_t route) {
+  void insert_path(std::string const& path, route_t route, std::size_t id) {
     auto n = root.get();
     std::set<std::string, std::less<>> vars;
 
@@ -69,10 +70,13 @@ public:
       throw std::invalid_argument("path already exists");
     }
     n->current = route;
+    n->id = id;
   }
 
-  route_t get_route(std::string_view path, std::map<std::string, std::string, std::less<>>& vars) {
+  route_t get_route(std::string_view path, std::map<std::string, std::string, std::less<>>& vars,
+                    std::size_t& id) {
     auto n = root.get();
+    id = raw.size();
 
     for (auto part_v : std::views::split(path.substr(1), DELIM)) {
       std::string_view part{part_v.begin(), part_v.end()};
@@ -89,7 +93,11 @@ public:
         n = it->second.get();
       }
     }
-    return n->current ? n->current : fallback;
+    if (!n->current) {
+      return fallback;
+    }
+    id = n->id;
+    return n->current;
   }
 };
 
@@ -120,10 +128,11 @@ void route_storage::build(std::string_view api_root) {
 
   s->root = std::make_unique<storage_t::node>();
 
-  for (auto& [path, route] : s->raw) {
+  for (std::size_t id = 0; id < s->raw.size(); ++id) {
+    auto& [path, route] = s->raw[id];
     path.insert(0, api_root);
     try {
-      s->insert_path(path, route);
+      s->insert_path(path, route, id);
     } catch (std::invalid_argument const& e) {
       std::throw_with_nested(std::runtime_error("inserting " + path + " failed"));
     }
@@ -136,6 +145,21 @@ void route_storage::set_fallback_route(route_t route) {
 }
 
 route_t route_storage::get_route(fcgx::request_t& r) {
+  std::size_t route_id;
+  return get_route(r, route_id);
+}
+
+route_t route_storage::get_route(fcgx::request_t& r, std::size_t& route_id) {
   assert(s->is_built);
-  return s->get_route(r.request_uri, r.params);
+  return s->get_route(r.request_uri, r.params, route_id);
+}
+
+std::vector<std::string> route_storage::get_route_names() const {
+  assert(s->is_built);
+  std::vector<std::string> names;
+  for (auto const& [path, route] : s->raw) {
+    names.push_back(path);
+  }
+  names.push_back("fallback");
+  return names;
 }
@@ -0,0 +1,53 @@
+#include "routes/attachment-cache.h"
+using namespace routes;
+
+namespace {
+std::size_t const CAPACITY = 4096;
+
+using lru_list = std::list<std::pair<std::string, attachment_cache::metadata>>;
+
+std::mutex lock;
+// Front is the most recently used entry.
+lru_list entries;
+std::unordered_map<std::string_view, lru_list::iterator> by_hash;
+uint64_t current_generation = 0;
+}  // namespace
+
+uint64_t attachment_cache::generation() {
+  std::lock_guard guard(lock);
+  return current_generation;
+}
+
+std::optional<attachment_cache::metadata> attachment_cache::find(std::string_view hash) {
+  std::lock_guard guard(lock);
+  auto it = by_hash.find(hash);
+  if (it == by_hash.end()) {
+    return std::nullopt;
+  }
+  entries.splice(entries.begin(), entries, it->second);
+  return it->second->second;
+}
+
+void attachment_cache::store(std::string_view hash, uint64_t generation, metadata m) {
+  std::lock_guard guard(lock);
+  if (generation != current_generation || by_hash.contains(hash)) {
+    return;
+  }
+  entries.emplace_front(std::string(hash), std::move(m));
+  by_hash[entries.front().first] = entries.begin();
+  if (entries.size() > CAPACITY) {
+    by_hash.erase(entries.back().first);
+    entries.pop_back();
+  }
+}
+
+void attachment_cache::invalidate(std::string_view hash) {
+  std::lock_guard guard(lock);
+  ++current_generation;
+  if (auto it = by_hash.find(hash); it != by_hash.end()) {
+    // Key of by_hash points into the list entry, so it has to go first.
+    auto entry = it->second;
+    by_hash.erase(it);
+    entries.erase(entry);
+  }
+}
@@ -0,0 +1,48 @@
+#include "routes/kim-cache.h"
+using namespace routes;
+
+namespace {
+struct entry {
+  int64_t token_version;
+  kim_cache::snapshot_ptr ptr;
+};
+
+std::shared_mutex lock;
+std::map<int64_t, entry> entries;
+std::atomic<uint64_t> current_generation = 0;
+}  // namespace
+
+uint64_t kim_cache::generation() {
+  return current_generation.load(std::memory_order_acquire);
+}
+
+kim_cache::snapshot_ptr kim_cache::find(int64_t kim_id, int64_t token_version) {
+  std::shared_lock read_guard(lock);
+  auto it = entries.find(kim_id);
+  if (it == entries.end() || it->second.token_version != token_version) {
+    return nullptr;
+  }
+  return it->second.ptr;
+}
+
+void kim_cache::store(int64_t kim_id, int64_t token_version, uint64_t generation,
+                      snapshot_ptr s) {
+  std::lock_guard write_guard(lock);
+  // Checked under the lock, so invalidation cannot slip in between the check and the insertion.
+  if (generation != current_generation.load(std::memory_order_relaxed)) {
+    return;
+  }
+  entries[kim_id] = {token_version, std::move(s)};
+}
+
+void kim_cache::invalidate(int64_t kim_id) {
+  std::lock_guard write_guard(lock);
+  ++current_generation;
+  entries.erase(kim_id);
+}
+
+void kim_cache::invalidate_all() {
+  std::lock_guard write_guard(lock);
+  ++current_generation;
+  entries.clear();
+}
@@ -0,0 +1,274 @@
+#include "routes/metrics.h"
+
+#include "async/coro.h"
+#include "async/libev-event-loop.h"
+#include "async/pq.h"
+#include "routes/session.h"
+using namespace routes;
+
+namespace {
+// Latencies are kept in microseconds in log-linear buckets, like in HDR histograms: every power of
+// two is split into SUB_COUNT equal buckets, so any recorded value is off by at most 25%.
+constexpr unsigned SUB_BITS = 2;
+constexpr std::size_t SUB_COUNT = std::size_t(1) << SUB_BITS;
+// Slower requests (more than ~67 s) all fall into the last bucket.
+constexpr unsigned MAX_BITS = 26;
+constexpr std::size_t BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_COUNT;
+
+constexpr auto SAMPLE_INTERVAL = std::chrono::seconds(1);
+constexpr std::array<double, 3> QUANTILES = {0.5, 0.9, 0.99};
+
+// Values are shifted by one before bucketing, so bucket limits are inclusive like `le` bounds of
+// Prometheus histograms.
+std::size_t bucket_of(uint64_t value) {
+  value = std::min(value ? value - 1 : 0, (uint64_t(1) << MAX_BITS) - 1);
+  if (value < SUB_COUNT) {
+    return value;
+  }
+  unsigned exp = unsigned(std::bit_width(value)) - 1;
+  return (exp - SUB_BITS + 1) * SUB_COUNT + ((value >> (exp - SUB_BITS)) & (SUB_COUNT - 1));
+}
+
+// Inclusive upper bound of values falling into the bucket
+uint64_t bucket_limit(std::size_t bucket) {
+  if (bucket < SUB_COUNT) {
+    return bucket + 1;
+  }
+  unsigned exp = unsigned(bucket / SUB_COUNT) + SUB_BITS - 1;
+  return uint64_t(SUB_COUNT + bucket % SUB_COUNT + 1) << (exp - SUB_BITS);
+}
+
+// Only the owning worker writes into its slot, so there is no need for read-modify-write
+// operations, relaxed atomics only keep scrapes from reading torn values.
+void bump(std::atomic<uint64_t>& counter, uint64_t delta = 1) {
+  counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+void set(std::atomic<uint64_t>& gauge, uint64_t value) {
+  gauge.store(value, std::memory_order_relaxed);
+}
+
+uint64_t get(std::atomic<uint64_t> const& value) {
+  return value.load(std::memory_order_relaxed);
+}
+
+struct route_stats {
+  std::atomic<uint64_t> failures = 0, latency_sum = 0;
+  std::array<std::atomic<uint64_t>, BUCKETS> latency{};
+};
+
+struct worker_slot {
+  std::size_t worker_id;
+  std::unique_ptr<route_stats[]> routes;
+
+  std::atomic<uint64_t> alive_coroutines = 0, ready_queue = 0;
+  std::atomic<uint64_t> db_alive = 0, db_idle = 0, db_waiters = 0, db_reconnects = 0;
+};
+
+std::vector<std::string> route_names;
+
+// Slots are never freed, so pointers to them stay valid after the lock is released.
+std::mutex slots_lock;
+std::vector<std::unique_ptr<worker_slot>> slots;
+
+thread_local worker_slot* local_slot = nullptr;
+
+void sample_gauges() {
+  auto& slot = *local_slot;
+  auto loop = async::libev_event_loop::get();
+  set(slot.alive_coroutines, uint64_t(std::max(loop->alive_coroutines, 0)));
+  set(slot.ready_queue, loop->ready_queue_size());
+
+  if (auto const& pool = async::pq::connection_pool::local) {
+    auto stats = pool->get_stats();
+    set(slot.db_alive, stats.alive);
+    set(slot.db_idle, stats.idle);
+    set(slot.db_waiters, stats.waiters);
+    set(slot.db_reconnects, stats.reconnects);
+  }
+}
+
+void schedule_sampling() {
+  auto continuation = [] {
+    sample_gauges();
+    schedule_sampling();
+  };
+  async::set_timeout(std::make_unique<std::function<void()>>(continuation), SAMPLE_INTERVAL);
+}
+
+struct merged_route {
+  uint64_t requests = 0, failures = 0, latency_sum = 0;
+  std::array<uint64_t, BUCKETS> latency{};
+
+  // Upper bound of the bucket containing the quantile, in microseconds
+  uint64_t quantile(double q) const {
+    auto rank = uint64_t(std::ceil(q * double(requests)));
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKETS; ++i) {
+      seen += latency[i];
+      if (seen >= rank) {
+        return bucket_limit(i);
+      }
+    }
+    return bucket_limit(BUCKETS - 1);
+  }
+};
+
+double to_seconds(uint64_t us) {
+  return double(us) / 1e6;
+}
+}  // namespace
+
+void metrics::init(std::vector<std::string> route_names_) {
+  route_names = std::move(route_names_);
+}
+
+/* ==== routes::metrics::collector ==== */
+metrics::collector::collector(std::size_t worker_id_) : worker_id(worker_id_) {}
+
+void metrics::collector::bind_to_thread() {
+  auto slot = std::make_unique<worker_slot>();
+  slot->worker_id = worker_id;
+  slot->routes = std::make_unique<route_stats[]>(route_names.size());
+  local_slot = slot.get();
+
+  std::lock_guard guard(slots_lock);
+  slots.push_back(std::move(slot));
+}
+
+void metrics::collector::on_init() {
+  sample_gauges();
+  schedule_sampling();
+}
+
+void metrics::record_request(std::size_t route_id, std::chrono::steady_clock::duration latency,
+                             bool failed) {
+  if (!local_slot || route_id >= route_names.size()) {
+    return;
+  }
+  auto& stats = local_slot->routes[route_id];
+  auto us = uint64_t(std::max<int64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(latency).count(), 0));
+  bump(stats.latency[bucket_of(us)]);
+  bump(stats.latency_sum, us);
+  if (failed) {
+    bump(stats.failures);
+  }
+}
+
+std::string metrics::render() {
+  std::vector<worker_slot const*> current;
+  {
+    std::lock_guard guard(slots_lock);
+    for (auto const& slot : slots) {
+      current.push_back(slot.get());
+    }
+  }
+
+  std::vector<merged_route> merged(route_names.size());
+  for (auto slot : current) {
+    for (std::size_t id = 0; id < route_names.size(); ++id) {
+      auto const& from = slot->routes[id];
+      auto& to = merged[id];
+      to.failures += get(from.failures);
+      to.latency_sum += get(from.latency_sum);
+      for (std::size_t i = 0; i < BUCKETS; ++i) {
+        auto count = get(from.latency[i]);
+        to.latency[i] += count;
+        to.requests += count;
+      }
+    }
+  }
+
+  std::string result;
+  auto out = std::back_inserter(result);
+  auto header = [&](std::string_view name, std::string_view type, std::string_view help) {
+    fmt::format_to(out, "# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+  };
+  // Routes which have never been requested are omitted to keep the output small.
+  auto for_each_route = [&](auto&& func) {
+    for (std::size_t id = 0; id < route_names.size(); ++id) {
+      if (merged[id].requests) {
+        func(route_names[id], merged[id]);
+      }
+    }
+  };
+
+  header("kege_requests_total", "counter", "Requests served.");
+  for_each_route([&](std::string_view route, merged_route const& m) {
+    fmt::format_to(out, "kege_requests_total{{route=\"{}\"}} {}\n", route, m.requests);
+  });
+
+  header("kege_request_failures_total", "counter", "Requests failed with an internal error.");
+  for_each_route([&](std::string_view route, merged_route const& m) {
+    fmt::format_to(out, "kege_request_failures_total{{route=\"{}\"}} {}\n", route, m.failures);
+  });
+
+  // Buckets are only exposed at powers of two, finer resolution is used for the quantiles below.
+  header("kege_request_duration_seconds", "histogram", "Time spent serving requests.");
+  for_each_route([&](std::string_view route, merged_route const& m) {
+    uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < BUCKETS; ++i) {
+      cumulative += m.latency[i];
+      if (std::has_single_bit(bucket_limit(i))) {
+        fmt::format_to(out, "kege_request_duration_seconds_bucket{{route=\"{}\",le=\"{}\"}} {}\n",
+                       route, to_seconds(bucket_limit(i)), cumulative);
+      }
+    }
+    fmt::format_to(out, "kege_request_duration_seconds_bucket{{route=\"{}\",le=\"+Inf\"}} {}\n",
+                   route, m.requests);
+    fmt::format_to(out, "kege_request_duration_seconds_sum{{route=\"{}\"}} {}\n", route,
+                   to_seconds(m.latency_sum));
+    fmt::format_to(out, "kege_request_duration_seconds_count{{route=\"{}\"}} {}\n", route,
+                   m.requests);
+  });
+
+  // Quantiles are upper bounds of the buckets containing them, computed over all requests since
+  // start-up.
+  header("kege_request_duration_quantiles_seconds", "summary",
+         "Time spent serving requests, by quantiles.");
+  for_each_route([&](std::string_view route, merged_route const& m) {
+    for (auto q : QUANTILES) {
+      fmt::format_to(out,
+                     "kege_request_duration_quantiles_seconds{{route=\"{}\",quantile=\"{}\"}} {}\n",
+                     route, q, to_seconds(m.quantile(q)));
+    }
+    fmt::format_to(out, "kege_request_duration_quantiles_seconds_sum{{route=\"{}\"}} {}\n", route,
+                   to_seconds(m.latency_sum));
+    fmt::format_to(out, "kege_request_duration_quantiles_seconds_count{{route=\"{}\"}} {}\n",
+                   route, m.requests);
+  });
+
+  auto per_worker = [&](std::string_view name, std::string_view type, std::string_view help,
+                        std::atomic<uint64_t> worker_slot::*field) {
+    header(name, type, help);
+    for (auto slot : current) {
+      fmt::format_to(out, "{}{{worker=\"{}\"}} {}\n", name, slot->worker_id, get(slot->*field));
+    }
+  };
+  per_worker("kege_alive_coroutines", "gauge", "Coroutines alive in the event loop.",
+             &worker_slot::alive_coroutines);
+  per_worker("kege_ready_queue_depth", "gauge", "Works waiting in the event loop's ready queue.",
+             &worker_slot::ready_queue);
+  per_worker("kege_db_connections", "gauge", "Alive connections in the database pool.",
+             &worker_slot::db_alive);
+  per_worker("kege_db_idle_connections", "gauge", "Idle connections in the database pool.",
+             &worker_slot::db_idle);
+  per_worker("kege_db_waiters", "gauge", "Requests waiting for a database connection.",
+             &worker_slot::db_waiters);
+  per_worker("kege_db_reconnects_total", "counter",
+             "Lost database connections replaced after start-up.", &worker_slot::db_reconnects);
+
+  header("kege_sessions", "gauge", "Sessions held in memory.");
+  fmt::format_to(out, "kege_sessions {}\n", session::count());
+
+  auto frames = async::get_frame_allocator_stats();
+  header("kege_coroutine_frames_allocated_total", "counter",
+         "Coroutine frames taken from the global allocator.");
+  fmt::format_to(out, "kege_coroutine_frames_allocated_total {}\n", frames.allocated);
+  header("kege_coroutine_frames_reused_total", "counter",
+         "Coroutine frames served from the free lists.");
+  fmt::format_to(out, "kege_coroutine_frames_reused_total {}\n", frames.reused);
+
+  return result;
+}
@@ -0,0 +1,109 @@
+#include "routes/scoreboard.h"
+using namespace routes;
+
+namespace {
+std::shared_mutex lock;
+std::map<std::pair<int64_t, int64_t>, scoreboard::board_ptr> boards;
+}  // namespace
+
+/* ==== routes::scoreboard::board ==== */
+void scoreboard::board::apply(submission const& s) {
+  auto task_it = task_position.find(s.task_id);
+  auto user_it = users.find(s.user_id);
+  if (task_it == task_position.end() || user_it == users.end()) {
+    // Either KIM or group was edited after the board had been built
+    return;
+  }
+
+  auto [it, is_inserted] = latest.try_emplace({s.task_id, s.user_id}, s);
+  if (!is_inserted) {
+    if (it->second.id >= s.id) {
+      return;
+    }
+    by_id.erase(it->second.id);
+    it->second = s;
+  }
+  by_id[s.id] = &it->second;
+
+  auto& u = user_it->second;
+  ranking.erase({u.total, u.id});
+  double& score = u.scores[task_it->second];
+  u.total += s.score - score;
+  score = s.score;
+  ranking.insert({u.total, u.id});
+}
+
+void scoreboard::board::load(std::vector<task> tasks_, std::vector<user> users_,
+                             std::vector<submission> const& submissions) {
+  std::lock_guard guard(lock);
+  assert(!is_loaded);
+
+  tasks = std::move(tasks_);
+  for (int i = 0; i < (int) tasks.size(); ++i) {
+    task_position[tasks[i].id] = i;
+  }
+  for (auto& u : users_) {
+    u.scores.assign(tasks.size(), 0);
+    u.total = 0;
+    auto id = u.id;
+    users.emplace(id, std::move(u));
+  }
+
+  for (auto const& s : submissions) {
+    apply(s);
+  }
+  for (auto const& s : pending) {
+    apply(s);
+  }
+  pending.clear();
+  pending.shrink_to_fit();
+  is_loaded = true;
+}
+
+/* ==== routes::scoreboard ==== */
+scoreboard::board_ptr scoreboard::find(int64_t kim_id, int64_t group_id) {
+  std::shared_lock read_guard(lock);
+  auto it = boards.find({kim_id, group_id});
+  if (it == boards.end() || !it->second->is_ready()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+scoreboard::board_ptr scoreboard::create(int64_t kim_id, int64_t group_id) {
+  auto result = std::make_shared<board>();
+  std::lock_guard write_guard(lock);
+  boards[{kim_id, group_id}] = result;
+  return result;
+}
+
+void scoreboard::discard(int64_t kim_id, int64_t group_id, board_ptr const& b) {
+  std::lock_guard write_guard(lock);
+  if (auto it = boards.find({kim_id, group_id}); it != boards.end() && it->second == b) {
+    boards.erase(it);
+  }
+}
+
+void scoreboard::invalidate(int64_t kim_id) {
+  std::lock_guard write_guard(lock);
+  boards.erase(boards.lower_bound({kim_id, INT64_MIN}), boards.upper_bound({kim_id, INT64_MAX}));
+}
+
+void scoreboard::invalidate_all() {
+  std::lock_guard write_guard(lock);
+  boards.clear();
+}
+
+void scoreboard::on_answer(int64_t kim_id, submission const& s) {
+  std::shared_lock read_guard(lock);
+  for (auto it = boards.lower_bound({kim_id, INT64_MIN});
+       it != boards.end() && it->first.first == kim_id; ++it) {
+    auto& b = *it->second;
+    std::lock_guard guard(b.lock);
+    if (b.is_loaded) {
+      b.apply(s);
+    } else {
+      b.pending.push_back(s);
+    }
+  }
+}
@@ -1,6 +1,9 @@
 #include "routes/session.h"
 
 #include "async/libev-event-loop.h"
+#include "async/pq.h"
+#include "async/tracing.h"
+#include "config.h"
 #include "utils/api.h"
 #include "utils/common.h"
 #include "utils/crypto.h"
@@ -9,86 +12,136 @@ using namespace routes;
 namespace {
 // We do not want to leak information about the session storage via session_id comparison times,
 // so we always sign user-supplied session_id with the following sign_key and then compare only
-// hashed values.
-utils::signature_t get_signed_id(std::string_view id) {
+// hashed values. With persistent sessions, persistent id is signed instead of session_id itself,
+// since only the former is known for sessions restored from the database.
+utils::signature_t sign_id(std::string_view id) {
   static std::string sign_key = utils::urandom(32);
   return utils::hmac_sign(id, sign_key);
 }
 
+utils::signature_t get_signed_id(std::string_view id) {
+  if (conf.persistent_sessions) {
+    return sign_id(session::persistent_id(id));
+  }
+  return sign_id(id);
+}
+
 using session_clock = std::chrono::system_clock;
 
-struct trie_node {
-  std::array<std::shared_ptr<trie_node>, 16> children;
-  std::shared_ptr<session> ptr;
+bool should_gc(session const& s) {
+  auto last_activity = session_clock::time_point(session_clock::duration(s.last_activity));
+  return s.logged_out || (session_clock::now() - last_activity) > session_logout_afk_time;
+}
 
-  std::shared_ptr<trie_node> clone() const {
-    return std::make_shared<trie_node>(children, ptr);
+// Signed ids are HMAC outputs, so any part of them is already a good hash.
+struct signed_id_hash {
+  std::size_t operator()(utils::signature_t const& id) const {
+    std::size_t result;
+    std::memcpy(&result, id.data(), sizeof(result));
+    return result;
   }
+};
 
-  std::shared_ptr<trie_node> gc_dfs(size_t& nodes_count) const {
-    if (ptr) {
-      bool should_gc = false;
-      should_gc |= ptr->logged_out;
-      auto last_activity = session_clock::time_point(session_clock::duration(ptr->last_activity));
-      should_gc |= (session_clock::now() - last_activity) > session_logout_afk_time;
+// Sessions are spread over independent shards, so that logins only contend with requests whose
+// ids happen to fall into the same shard. Lookups take a shared lock of a single shard and do
+// not touch any global state.
+constexpr std::size_t SHARDS_COUNT = 64;
 
-      if (should_gc) {
-        return nullptr;
-      } else {
-        ++nodes_count;
-        return std::make_shared<trie_node>(decltype(children){}, ptr);
-      }
-    } else {
-      std::shared_ptr<trie_node> new_node;
-      for (size_t i = 0; i < 16; ++i) {
-        auto child = children[i];
-        if (!children[i]) {
-          continue;
-        }
-
-        auto new_child = child->gc_dfs(nodes_count);
-        if (!new_child) {
-          continue;
-        }
-
-        if (!new_node) {
-          ++nodes_count;
-          new_node = std::make_shared<trie_node>();
-        }
-        new_node->children[i] = new_child;
-      }
-      return new_node;
-    }
-  }
+struct stored_session {
+  std::shared_ptr<session> s;
+  // Empty unless sessions are persistent
+  std::string persistent_id;
 };
 
-// FIXME: Do not block worker thread entirely, just one coroutine.
-std::mutex write_lock;
-// FIXME: Do not use atomic<shared_ptr>
-std::atomic<std::shared_ptr<trie_node>> root_node;
+struct alignas(64) shard {
+  std::shared_mutex lock;
+  std::unordered_map<utils::signature_t, stored_session, signed_id_hash> sessions;
+};
+
+std::array<shard, SHARDS_COUNT> shards;
+
+shard& shard_of(utils::signature_t const& id) {
+  // Bytes used by signed_id_hash are skipped, so that entries within a shard are still spread
+  // evenly over the buckets.
+  return shards[static_cast<unsigned char>(id[sizeof(std::size_t)]) % SHARDS_COUNT];
+}
 
-coro<void> run_session_gc() {
-  logi("Running session GC (note: locking all login attemps)...");
+// Expired sessions are reclaimed a shard at a time, so that every tick only briefly blocks logins
+// falling into a single shard. Each worker runs its own ticks and they share the cursor, hence
+// the whole storage is swept every SHARDS_COUNT * GC_TICK / workers.
+constexpr auto GC_TICK = std::chrono::seconds(10);
+std::atomic<std::size_t> gc_cursor = 0;
 
-  size_t nodes_count = 0;
+coro<void> delete_persistent_sessions(std::vector<std::string> ids) {
+  auto db = async::pq::connection_pool::local->get_lazy_connection();
+  co_await db.exec("DELETE FROM sessions WHERE id = ANY($1::bytea[])", ids);
+}
+
+void run_gc_tick() {
+  auto& current = shards[gc_cursor.fetch_add(1, std::memory_order_relaxed) % SHARDS_COUNT];
+
+  std::vector<utils::signature_t> expired;
   {
-    // FIXME: This is a "stop the world" GC, which I'm not really a fan of.
-    std::lock_guard write_guard(write_lock);
-    auto root = root_node.load();
-    if (root) {
-      root_node = root->gc_dfs(nodes_count);
+    std::shared_lock read_guard(current.lock);
+    for (auto const& [id, stored] : current.sessions) {
+      if (should_gc(*stored.s)) {
+        expired.push_back(id);
+      }
     }
   }
-  logi("Session GC done, {} nodes in session trie", nodes_count);
+  if (expired.empty()) {
+    return;
+  }
 
-  auto continuation = [] { schedule_detached(run_session_gc()); };
-  async::set_timeout(std::make_unique<std::function<void()>>(continuation), std::chrono::hours(1));
-  // Прыщи? Ноль! Угри? Ноль! Boilerplate? Ноль!
+  // Sessions are destroyed outside of the lock.
+  std::vector<stored_session> reclaimed;
+  {
+    std::lock_guard write_guard(current.lock);
+    for (auto const& id : expired) {
+      // Session might have been used since the scan
+      auto it = current.sessions.find(id);
+      if (it != current.sessions.end() && should_gc(*it->second.s)) {
+        reclaimed.push_back(std::move(it->second));
+        current.sessions.erase(it);
+      }
+    }
+  }
 
-  co_return;
+  // Logged out sessions are removed from the database by the logout itself, while AFK ones would
+  // otherwise be restored again on the next start.
+  std::vector<std::string> afk_ids;
+  for (auto& stored : reclaimed) {
+    if (!stored.persistent_id.empty() && !stored.s->logged_out) {
+      afk_ids.push_back(std::move(stored.persistent_id));
+    }
+  }
+  if (!afk_ids.empty()) {
+    async::schedule_detached(async::without_task_context(
+        [&] { return delete_persistent_sessions(std::move(afk_ids)); }));
+  }
+}
+
+void schedule_gc_tick() {
+  auto continuation = [] {
+    run_gc_tick();
+    schedule_gc_tick();
+  };
+  async::set_timeout(std::make_unique<std::function<void()>>(continuation), GC_TICK);
 }
 }  // namespace
 
+void session::note_write() {
+  last_write = session_clock::now().time_since_epoch().count();
+}
+
+async::pq::replica_routing session::routing_for_reads(async::pq::replica_routing wanted) const {
+  auto last = session_clock::time_point(session_clock::duration(last_write));
+  if (session_clock::now() - last < std::chrono::milliseconds(conf.db.replica_max_lag)) {
+    return async::pq::replica_routing::NONE;
+  }
+  return wanted;
+}
+
 bool session::is_owner_of(int64_t id) const {
   auto current_range = id_ranges.load();
   while (current_range) {
@@ -105,51 +158,79 @@ api::UserInfo::initializable_type session::serialize() const {
 }
 
 coro<void> session::save(std::shared_ptr<session> s, std::string_view session_id) {
-  std::lock_guard write_guard(write_lock);
   auto signed_id = get_signed_id(session_id);
-
-  auto new_root = root_node.load();
-  if (!new_root) {
-    new_root = std::make_shared<trie_node>();
-  } else {
-    new_root = new_root->clone();
+  s->last_activity = session_clock::now().time_since_epoch().count();
+  stored_session stored{.s = std::move(s)};
+  if (conf.persistent_sessions) {
+    stored.persistent_id = persistent_id(session_id);
   }
-  auto current = new_root.get();
 
-  for (size_t i = 0; i < 2 * utils::signature_length; ++i) {
-    unsigned nibble = signed_id[i / 2] >> (i % 2 * 4) & 15;
-    auto& child = current->children[nibble];
-
-    if (!child) {
-      child = std::make_shared<trie_node>();
-      current = child.get();
-    } else {
-      child = child->clone();
-      current = child.get();
+  {
+    auto& current = shard_of(signed_id);
+    std::lock_guard write_guard(current.lock);
+    if (!current.sessions.try_emplace(signed_id, std::move(stored)).second) {
+      throw std::runtime_error("Session was already saved in the storage");
     }
   }
+  co_return;
+}
+
+std::string session::persistent_id(std::string_view session_id) {
+  return utils::sha3_256(session_id);
+}
+
+void session::restore(std::string const& db_path) {
+  logi("Restoring sessions from the database...");
 
-  if (current->ptr) {
-    throw std::runtime_error("Session was already saved in the storage");
+  auto conn = PQconnectdb(db_path.c_str());
+  utils::scope_guard conn_guard([&] { PQfinish(conn); });
+  if (PQstatus(conn) != CONNECTION_OK) {
+    throw async::pq::db_error(PQerrorMessage(conn));
   }
-  s->last_activity = session_clock::now().time_since_epoch().count();
-  current->ptr = s;
 
-  root_node = new_root;
+  auto exec = [&](std::string const& command) {
+    return async::pq::result{PQexecParams(conn, command.c_str(), 0, nullptr, nullptr, nullptr,
+                                          nullptr, 1)};
+  };
+
+  auto max_age = std::chrono::duration_cast<std::chrono::seconds>(session_max_age).count();
+  exec(fmt::format("DELETE FROM sessions WHERE created_at < now() - make_interval(secs => {})",
+                   max_age));
+  auto q = exec(
+      "SELECT sessions.id, users.id, username, display_name, permissions FROM sessions JOIN users "
+      "ON users.id = sessions.user_id");
 
-  static bool gc_summoned = false;
-  if (!gc_summoned) [[unlikely]] {
-    gc_summoned = true;
+  // Time spent offline should not count as AFK time.
+  auto now = session_clock::now().time_since_epoch().count();
+  for (auto [id, user_id, username, display_name, perms] :
+       q.iter<std::string_view, int64_t, std::string, std::string, unsigned>()) {
+    auto s = std::make_shared<session>(user_id, username, display_name, perms);
+    s->last_activity = now;
 
-    // FIXME: Run GC in a separate thread
-    auto continuation = [] { schedule_detached(run_session_gc()); };
-    async::set_timeout(std::make_unique<std::function<void()>>(continuation),
-                       std::chrono::hours(1));
+    auto signed_id = sign_id(id);
+    auto& current = shard_of(signed_id);
+    std::lock_guard write_guard(current.lock);
+    current.sessions.try_emplace(signed_id, stored_session{std::move(s), std::string(id)});
   }
-  co_return;
+  logi("Restored {} sessions", q.rows());
+}
+
+std::size_t session::count() {
+  std::size_t result = 0;
+  for (auto& current : shards) {
+    std::shared_lock read_guard(current.lock);
+    result += current.sessions.size();
+  }
+  return result;
+}
+
+/* ==== routes::session_gc ==== */
+void session_gc::on_init() {
+  schedule_gc_tick();
 }
 
 coro<std::shared_ptr<session>> routes::require_auth(fcgx::request_t* r, Permission mask) {
+  async::tracing::span span("require_auth");
   auto raise_access_denied = [&r] { utils::err(r, api::ACCESS_DENIED); };
 
   auto cookies_it = r->cookies.find("kege-session");
@@ -158,25 +239,15 @@ coro<std::shared_ptr<session>> routes::require_auth(fcgx::request_t* r, Permissi
   }
   auto signed_id = get_signed_id(utils::b16_decode(cookies_it->second));
 
-  auto root = root_node.load();
-  auto current = root.get();
-
-  if (!current) {
-    raise_access_denied();
-  }
-
-  for (size_t i = 0; i < 2 * utils::signature_length; ++i) {
-    unsigned nibble = signed_id[i / 2] >> (i % 2 * 4) & 15;
-    auto& child = current->children[nibble];
-
-    if (!child) {
-      raise_access_denied();
-    } else {
-      current = child.get();
+  std::shared_ptr<session> s;
+  {
+    auto& current = shard_of(signed_id);
+    std::shared_lock read_guard(current.lock);
+    if (auto it = current.sessions.find(signed_id); it != current.sessions.end()) {
+      s = it->second.s;
     }
   }
 
-  auto s = current->ptr;
   auto i_mask = static_cast<unsigned>(mask);
   if (!s || s->logged_out || (s->perms & i_mask) != i_mask) {
     raise_access_denied();
@@ -25,16 +25,34 @@ signature_t utils::hmac_sign(std::string_view value, std::string_view key) {
 }
 
 std::string utils::sha3_256(std::string_view data) {
+  sha3_256_hasher hasher;
+  hasher.update(data);
+  return hasher.finish();
+}
+
+/* ==== utils::sha3_256_hasher ==== */
+sha3_256_hasher::sha3_256_hasher() : context(EVP_MD_CTX_new()) {
+  if (!context) {
+    throw std::bad_alloc();
+  }
+  EVP_DigestInit_ex(static_cast<EVP_MD_CTX*>(context), EVP_sha3_256(), nullptr);
+}
+
+sha3_256_hasher::~sha3_256_hasher() {
+  EVP_MD_CTX_destroy(static_cast<EVP_MD_CTX*>(context));
+}
+
+void sha3_256_hasher::update(std::string_view data) {
+  EVP_DigestUpdate(static_cast<EVP_MD_CTX*>(context), data.data(), data.size());
+}
+
+std::string sha3_256_hasher::finish() {
   static constexpr size_t hash_length = 32;
 
   unsigned result_len;
   std::string result(hash_length, 0);
-
-  EVP_MD_CTX* context = EVP_MD_CTX_new();
-  EVP_DigestInit_ex(context, EVP_sha3_256(), nullptr);
-  EVP_DigestUpdate(context, data.data(), data.size());
-  EVP_DigestFinal_ex(context, reinterpret_cast<uchar*>(result.data()), &result_len);
-  EVP_MD_CTX_destroy(context);
+  EVP_DigestFinal_ex(static_cast<EVP_MD_CTX*>(context), reinterpret_cast<uchar*>(result.data()),
+                     &result_len);
   assert(result_len == hash_length);
 
   return result;
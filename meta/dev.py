@@ -74,6 +74,7 @@ NGINX = Container(
     "-v", f"{ROOT}/build/var/www/html:/var/www/html/build",
     "-v", f"{ROOT}/build/var/run/kege:/var/run/kege",
     "-v", f"{ROOT}/ui/static:/var/www/html/static",
+    "-v", f"{ROOT}/build/var/lib/kege/files:/var/lib/kege/files:ro",
     "-p", "5001:80"
   ],
   command=[],
@@ -42,6 +42,7 @@ CREATE TABLE task_attachments (
 
 	FOREIGN KEY (task_id) REFERENCES tasks(id) ON DELETE CASCADE
 );
+CREATE INDEX task_attachments_hash_idx ON task_attachments (hash);
 
 CREATE TABLE kims (
 	id bigint DEFAULT nextval('builtin_id_sequence') NOT NULL PRIMARY KEY,
@@ -72,6 +73,15 @@ CREATE TABLE users (
 	UNIQUE (username)
 );
 
+-- Used only if persistent_sessions is on in config.json
+CREATE TABLE sessions (
+	id bytea NOT NULL PRIMARY KEY, -- = sha3_256(session_id)
+	user_id bigint NOT NULL,
+	created_at timestamp with time zone DEFAULT CURRENT_TIMESTAMP NOT NULL,
+
+	FOREIGN KEY (user_id) REFERENCES users(id) ON DELETE CASCADE
+);
+
 CREATE TABLE groups (
 	id bigint DEFAULT nextval('builtin_id_sequence') NOT NULL PRIMARY KEY,
 	display_name text
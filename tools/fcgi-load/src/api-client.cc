@@ -0,0 +1,61 @@
+#include "api-client.h"
+
+api_client::api_client(std::vector<endpoint> const& endpoints_, std::size_t first_endpoint,
+                       string api_root_, recorder& stats_)
+    : endpoints(endpoints_),
+      next_endpoint(first_endpoint),
+      api_root(std::move(api_root_)),
+      stats(stats_) {}
+
+api::Response api_client::call(string const& route, google::protobuf::MessageLite const* request,
+                               string const& query, string const& label) {
+  string body;
+  if (request) {
+    request->SerializeToString(&body);
+  }
+
+  std::vector<std::pair<string, string>> params = {
+      {"REQUEST_METHOD", "POST"},
+      {"DOCUMENT_URI", api_root + route},
+      {"QUERY_STRING", query},
+      {"REMOTE_ADDR", "127.0.0.1"},
+      {"HTTP_CONTENT_TYPE", "application/x-protobuf"},
+      {"CONTENT_LENGTH", std::to_string(body.size())},
+  };
+  if (cookie.size()) {
+    params.emplace_back("HTTP_COOKIE", "kege-session=" + cookie);
+  }
+
+  auto const& to = endpoints[next_endpoint++ % endpoints.size()];
+
+  api::Response response;
+  auto start = clock_type::now();
+  try {
+    auto raw = fcgi_request(to, params, body);
+    if (!response.ParseFromString(raw.body)) {
+      response.set_code(api::INTERNAL_ERROR);
+    }
+    for (auto const& header : raw.headers) {
+      std::string_view prefix = "Set-Cookie: kege-session=";
+      if (header.starts_with(prefix)) {
+        auto value = header.substr(prefix.size());
+        cookie = value.substr(0, value.find(';'));
+      }
+    }
+  } catch (fcgi_error const&) {
+    response.set_code(api::INTERNAL_ERROR);
+  }
+  stats.add(label.size() ? label : route, clock_type::now() - start, response.code() == api::OK);
+  return response;
+}
+
+bool api_client::call(string const& route, google::protobuf::MessageLite const* request,
+                      google::protobuf::MessageLite& response, string const& query,
+                      string const& label) {
+  auto raw = call(route, request, query, label);
+  return raw.code() == api::OK && response.ParseFromString(raw.response());
+}
+
+bool api_client::has_session() const {
+  return cookie.size() && cookie != "invalid";
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include <google/protobuf/message_lite.h>
+
+#include "api.pb.h"
+#include "fcgi-client.h"
+#include "stats.h"
+
+// Client of the KEGE API for a single virtual user. Keeps the session cookie and records
+// latency of every call.
+class api_client {
+private:
+  std::vector<endpoint> const& endpoints;
+  std::size_t next_endpoint;
+  string api_root;
+  string cookie;
+  recorder& stats;
+
+public:
+  api_client(std::vector<endpoint> const& endpoints_, std::size_t first_endpoint,
+             string api_root_, recorder& stats_);
+
+  // Calls `route` and returns the decoded response. Latency is recorded under `label` (or the
+  // route itself). Failed requests (including the ones with non-OK code) are recorded as errors;
+  // the returned response has INTERNAL_ERROR code if the request did not complete at all.
+  api::Response call(string const& route, google::protobuf::MessageLite const* request,
+                     string const& query = "", string const& label = "");
+
+  // Same as above, parses the payload into `response`. Returns whether the call succeeded.
+  bool call(string const& route, google::protobuf::MessageLite const* request,
+            google::protobuf::MessageLite& response, string const& query = "",
+            string const& label = "");
+
+  bool has_session() const;
+};
@@ -0,0 +1,233 @@
+#include "fcgi-client.h"
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+enum record_type : unsigned char {
+  BEGIN_REQUEST = 1,
+  END_REQUEST = 3,
+  PARAMS = 4,
+  STDIN = 5,
+  STDOUT = 6,
+  STDERR = 7,
+};
+
+const unsigned char VERSION = 1;
+const unsigned char ROLE_RESPONDER = 1;
+const std::size_t MAX_RECORD_CONTENT = 65535;
+
+struct socket_guard {
+  int fd;
+
+  ~socket_guard() {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+};
+
+int connect_to(endpoint const& to) {
+  if (to.is_unix) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (to.path.size() >= sizeof(addr.sun_path)) {
+      throw fcgi_error("socket path is too long: " + to.path);
+    }
+    std::strcpy(addr.sun_path, to.path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+      throw fcgi_error("socket failed");
+    }
+    if (connect(fd, (sockaddr*) &addr, sizeof(addr))) {
+      close(fd);
+      throw fcgi_error(fmt::format("connect to {} failed: {}", to.to_string(), strerror(errno)));
+    }
+    return fd;
+  }
+
+  addrinfo hints{};
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* result;
+  if (getaddrinfo(to.path.c_str(), to.port.c_str(), &hints, &result)) {
+    throw fcgi_error("getaddrinfo for " + to.to_string() + " failed");
+  }
+  int fd = -1;
+  for (addrinfo* it = result; it; it = it->ai_next) {
+    fd = socket(it->ai_family, it->ai_socktype, it->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    if (!connect(fd, it->ai_addr, it->ai_addrlen)) {
+      break;
+    }
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(result);
+  if (fd < 0) {
+    throw fcgi_error("connect to " + to.to_string() + " failed");
+  }
+  return fd;
+}
+
+void append_record(string& out, record_type type, std::string_view content) {
+  unsigned char header[8] = {
+      VERSION,
+      type,
+      0,
+      1,  // request id
+      (unsigned char) (content.size() >> 8),
+      (unsigned char) (content.size() & 0xff),
+      0,
+      0,
+  };
+  out.append((char*) header, sizeof(header));
+  out.append(content);
+}
+
+void append_stream(string& out, record_type type, std::string_view data) {
+  for (std::size_t i = 0; i < data.size(); i += MAX_RECORD_CONTENT) {
+    append_record(out, type, data.substr(i, MAX_RECORD_CONTENT));
+  }
+  append_record(out, type, {});
+}
+
+void append_length(string& out, std::size_t length) {
+  if (length < 128) {
+    out += (char) length;
+  } else {
+    out += (char) ((length >> 24) | 0x80);
+    out += (char) (length >> 16);
+    out += (char) (length >> 8);
+    out += (char) length;
+  }
+}
+
+void write_all(int fd, std::string_view data) {
+  while (data.size()) {
+    ssize_t cnt = write(fd, data.data(), data.size());
+    if (cnt < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw fcgi_error(fmt::format("write failed: {}", strerror(errno)));
+    }
+    data.remove_prefix((std::size_t) cnt);
+  }
+}
+
+bool read_exactly(int fd, char* buf, std::size_t size) {
+  std::size_t done = 0;
+  while (done < size) {
+    ssize_t cnt = read(fd, buf + done, size - done);
+    if (cnt < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw fcgi_error(fmt::format("read failed: {}", strerror(errno)));
+    }
+    if (!cnt) {
+      return false;
+    }
+    done += (std::size_t) cnt;
+  }
+  return true;
+}
+
+void parse_stdout(string const& out, fcgi_response& response) {
+  auto end = out.find("\r\n\r\n");
+  if (end == string::npos) {
+    throw fcgi_error("malformed response headers");
+  }
+  std::string_view headers{out.data(), end};
+  while (headers.size()) {
+    auto eol = headers.find("\r\n");
+    auto line = headers.substr(0, eol);
+    headers.remove_prefix(eol == std::string_view::npos ? headers.size() : eol + 2);
+
+    auto colon = line.find(':');
+    if (colon != std::string_view::npos) {
+      auto name = line.substr(0, colon);
+      auto value = line.substr(colon + 1);
+      while (value.size() && value[0] == ' ') {
+        value.remove_prefix(1);
+      }
+      if (strncasecmp(name.data(), "status", name.size()) == 0 && name.size() == 6) {
+        response.status = std::atoi(string(value).c_str());
+      }
+    }
+    response.headers.emplace_back(line);
+  }
+  response.body = out.substr(end + 4);
+}
+}  // namespace
+
+/* ==== endpoint ==== */
+endpoint endpoint::parse(std::string_view s) {
+  if (s.starts_with("unix:")) {
+    return {true, string(s.substr(5)), ""};
+  } else if (s.starts_with("tcp:")) {
+    s.remove_prefix(4);
+    auto colon = s.rfind(':');
+    if (colon == std::string_view::npos) {
+      throw std::invalid_argument("tcp endpoint should be tcp:<host>:<port>");
+    }
+    return {false, string(s.substr(0, colon)), string(s.substr(colon + 1))};
+  }
+  // Plain paths are unix sockets
+  return {true, string(s), ""};
+}
+
+string endpoint::to_string() const {
+  return is_unix ? "unix:" + path : "tcp:" + path + ":" + port;
+}
+
+/* ==== fcgi_request ==== */
+fcgi_response fcgi_request(endpoint const& to, std::vector<std::pair<string, string>> const& params,
+                           std::string_view body) {
+  socket_guard sock{connect_to(to)};
+
+  string request;
+  unsigned char begin[8] = {0, ROLE_RESPONDER, 0, 0, 0, 0, 0, 0};
+  append_record(request, BEGIN_REQUEST, {(char*) begin, sizeof(begin)});
+
+  string encoded_params;
+  for (auto const& [name, value] : params) {
+    append_length(encoded_params, name.size());
+    append_length(encoded_params, value.size());
+    encoded_params += name;
+    encoded_params += value;
+  }
+  append_stream(request, PARAMS, encoded_params);
+  append_stream(request, STDIN, body);
+  write_all(sock.fd, request);
+
+  string out;
+  while (true) {
+    unsigned char header[8];
+    if (!read_exactly(sock.fd, (char*) header, sizeof(header))) {
+      throw fcgi_error("connection closed before the end of request");
+    }
+    std::size_t content_length = (std::size_t(header[4]) << 8) | header[5];
+    std::size_t padding_length = header[6];
+    string content(content_length + padding_length, '\0');
+    if (!read_exactly(sock.fd, content.data(), content.size())) {
+      throw fcgi_error("connection closed in the middle of a record");
+    }
+    content.resize(content_length);
+
+    if (header[1] == STDOUT) {
+      out += content;
+    } else if (header[1] == END_REQUEST) {
+      break;
+    }
+  }
+
+  fcgi_response response;
+  parse_stdout(out, response);
+  return response;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "stdafx.h"
+
+// Address of a FastCGI socket, written as "unix:<path>" or "tcp:<host>:<port>".
+struct endpoint {
+  bool is_unix;
+  string path;
+  string port;
+
+  static endpoint parse(std::string_view s);
+  string to_string() const;
+};
+
+struct fcgi_response {
+  int status = 200;
+  std::vector<string> headers;
+  string body;
+};
+
+class fcgi_error : public std::runtime_error {
+  using runtime_error::runtime_error;
+};
+
+// Performs a single request over a fresh connection (KEGE does not keep FastCGI connections
+// alive). Blocking; intended to be used from a dedicated thread.
+fcgi_response fcgi_request(endpoint const& to, std::vector<std::pair<string, string>> const& params,
+                           std::string_view body);
@@ -0,0 +1,179 @@
+// Load generator speaking FastCGI directly to KEGE workers.
+//
+// Usage:
+//   fcgi-load seed [options] | psql ...   prints SQL creating users, a group and a KIM to load
+//   fcgi-load [run] [options]             replays exam traffic and prints per-route statistics
+//
+// See `fcgi-load --help` for options.
+#include "stdafx.h"
+
+#include "scenario.h"
+#include "seed.h"
+
+namespace {
+char const* const HELP = R"(Usage: fcgi-load [seed|run] [options]
+
+Common options:
+  --contestants=N          Number of contestants (default: 50)
+  --user-prefix=S          Contestants are named <prefix><i> (default: load-)
+  --kim=NAME               Name of the KIM (default: load-test)
+  --group=NAME             Name of the group (default: load-test)
+
+Seed options:
+  --tasks=N                Number of tasks in the KIM (default: 25)
+
+Run options:
+  --socket=ADDR            unix:<path>, tcp:<host>:<port> or a plain path; may be repeated,
+                           requests are spread between sockets (default: build/run/fcgi.sock)
+  --api-root=PATH          API root from config.json (default: /api)
+  --password=S             Password of contestants (default: password)
+  --admins=N               Number of admins polling standings (default: 1)
+  --admin=USER:PASSWORD    Admin credentials (default: admin:password)
+  --duration=SECONDS       Length of the run (default: 60)
+  --ramp-up=SECONDS        Users start uniformly within this period (default: 5)
+  --burst=N                Answers submitted in a row (default: 5)
+  --think-ms=MS            Pause between bursts (default: 2000)
+  --reload-every=N         Reload tasks every N bursts, 0 to disable (default: 5)
+  --standings-ms=MS        Pause between standings requests (default: 2000)
+  --json                   Print results as JSON
+)";
+
+struct parsed_args {
+  string command = "run";
+  std::map<string, string> values;
+  std::vector<string> sockets;
+};
+
+parsed_args parse_args(int argc, char** argv) {
+  parsed_args result;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (!arg.starts_with("--")) {
+      if (i != 1) {
+        throw std::invalid_argument("unexpected argument " + string(arg));
+      }
+      result.command = arg;
+      continue;
+    }
+    arg.remove_prefix(2);
+    auto eq = arg.find('=');
+    string key{arg.substr(0, eq)};
+    string value = eq == std::string_view::npos ? "" : string(arg.substr(eq + 1));
+    if (key == "socket") {
+      result.sockets.push_back(value);
+    } else {
+      result.values[key] = value;
+    }
+  }
+  return result;
+}
+
+options make_options(parsed_args const& args) {
+  options opts;
+  auto get = [&](string const& key, auto& into) {
+    auto it = args.values.find(key);
+    if (it == args.values.end()) {
+      return;
+    }
+    using T = std::decay_t<decltype(into)>;
+    if constexpr (std::is_same_v<T, string>) {
+      into = it->second;
+    } else if constexpr (std::is_same_v<T, int>) {
+      into = std::stoi(it->second);
+    } else {
+      into = T(std::stoll(it->second));
+    }
+  };
+
+  get("contestants", opts.contestants);
+  get("user-prefix", opts.user_prefix);
+  get("password", opts.password);
+  get("kim", opts.kim_name);
+  get("group", opts.group_name);
+  get("api-root", opts.api_root);
+  get("admins", opts.admins);
+  get("duration", opts.duration);
+  get("ramp-up", opts.ramp_up);
+  get("burst", opts.burst);
+  get("think-ms", opts.think_time);
+  get("reload-every", opts.reload_every);
+  get("standings-ms", opts.standings_interval);
+  opts.json = args.values.contains("json");
+
+  if (auto it = args.values.find("admin"); it != args.values.end()) {
+    auto colon = it->second.find(':');
+    if (colon == string::npos) {
+      throw std::invalid_argument("--admin should be USER:PASSWORD");
+    }
+    opts.admin_username = it->second.substr(0, colon);
+    opts.admin_password = it->second.substr(colon + 1);
+  }
+
+  for (auto const& s : args.sockets) {
+    opts.endpoints.push_back(endpoint::parse(s));
+  }
+  if (opts.endpoints.empty()) {
+    opts.endpoints.push_back(endpoint::parse("build/run/fcgi.sock"));
+  }
+  if (opts.contestants < 1) {
+    throw std::invalid_argument("there should be at least one contestant");
+  }
+  return opts;
+}
+
+void run(options const& opts) {
+  int users = opts.contestants + opts.admins;
+  std::vector<recorder> stats(users);
+  std::vector<std::thread> threads;
+
+  fmt::print(stderr, "Running {} contestants and {} admins for {} s against {}...\n",
+             opts.contestants, opts.admins, opts.duration.count(),
+             fmt::join(opts.endpoints | std::views::transform(&endpoint::to_string), ", "));
+
+  auto start = clock_type::now();
+  auto deadline = start + opts.ramp_up + opts.duration;
+  for (int i = 0; i < opts.contestants; ++i) {
+    threads.emplace_back(run_contestant, std::cref(opts), i, deadline, std::ref(stats[i]));
+  }
+  for (int i = 0; i < opts.admins; ++i) {
+    threads.emplace_back(run_admin, std::cref(opts), i, deadline,
+                         std::ref(stats[opts.contestants + i]));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  auto elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+
+  recorder total;
+  for (auto const& s : stats) {
+    total.merge(s);
+  }
+  total.report(elapsed, opts.json);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  try {
+    auto args = parse_args(argc, argv);
+    if (args.command == "help" || args.values.contains("help")) {
+      fmt::print("{}", HELP);
+      return 0;
+    }
+
+    auto opts = make_options(args);
+    if (args.command == "seed") {
+      int tasks = 25;
+      if (auto it = args.values.find("tasks"); it != args.values.end()) {
+        tasks = std::stoi(it->second);
+      }
+      print_seed(opts, tasks);
+    } else if (args.command == "run") {
+      run(opts);
+    } else {
+      throw std::invalid_argument("unknown command " + args.command);
+    }
+  } catch (std::exception const& e) {
+    fmt::print(stderr, "fcgi-load: {}\n\n{}", e.what(), HELP);
+    return 1;
+  }
+}
@@ -0,0 +1,146 @@
+#include "scenario.h"
+
+#include "api-client.h"
+#include "contestant.pb.h"
+#include "groups.pb.h"
+#include "kims.pb.h"
+#include "standings.pb.h"
+#include "user.pb.h"
+
+namespace {
+// Sleeps for `duration` scaled by a random factor in [0.5, 1.5], so users do not march in step.
+void think(std::mt19937& rng, std::chrono::milliseconds duration, clock_type::time_point deadline) {
+  std::uniform_real_distribution<double> factor(0.5, 1.5);
+  auto until = clock_type::now() + std::chrono::duration_cast<clock_type::duration>(
+                                       duration * factor(rng));
+  std::this_thread::sleep_until(std::min(until, deadline));
+}
+
+bool login(api_client& client, string const& username, string const& password) {
+  api::LoginRequest request;
+  request.set_username(username);
+  request.set_password(password);
+  api::UserInfo info;
+  return client.call("/user/login", &request, info) && client.has_session();
+}
+
+void ramp_up(options const& opts, std::mt19937& rng) {
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(opts.ramp_up).count();
+  if (ms > 0) {
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(std::uniform_int_distribution<int64_t>(0, ms)(rng)));
+  }
+}
+}  // namespace
+
+void run_contestant(options const& opts, int index, clock_type::time_point deadline,
+                    recorder& stats) {
+  std::mt19937 rng((unsigned) index);
+  api_client client(opts.endpoints, (std::size_t) index, opts.api_root, stats);
+  ramp_up(opts, rng);
+
+  if (!login(client, opts.user_prefix + std::to_string(index), opts.password)) {
+    stats.fail("contestant login failed");
+    return;
+  }
+
+  api::ContestantKimList kims;
+  if (!client.call("/contestant/available-kims", nullptr, kims)) {
+    stats.fail("available KIMs request failed");
+    return;
+  }
+  auto kim_it = std::ranges::find_if(kims.kims(), [&](api::ContestantKim const& kim) {
+    return kim.name() == opts.kim_name &&
+           (kim.status() == api::IN_PROGRESS || kim.status() == api::VIRTUAL_STARTABLE);
+  });
+  if (kim_it == kims.kims().end()) {
+    stats.fail("no startable KIM named " + opts.kim_name);
+    return;
+  }
+  int64_t kim_id = kim_it->id();
+
+  api::ContestantKim kim;
+  auto tasks_query = "id=" + std::to_string(kim_id);
+  if (!client.call("/contestant/tasks", nullptr, kim, tasks_query) || kim.tasks().empty()) {
+    stats.fail("tasks request failed");
+    return;
+  }
+  string write_token = kim.write_token();
+  string etag = kim.tasks_etag();
+  std::vector<int64_t> task_ids;
+  for (auto const& task : kim.tasks()) {
+    task_ids.push_back(task.id());
+  }
+
+  std::uniform_int_distribution<std::size_t> pick_task(0, task_ids.size() - 1);
+  std::uniform_int_distribution<int> pick_answer(0, 99);
+
+  for (int bursts = 1; clock_type::now() < deadline; ++bursts) {
+    for (int i = 0; i < opts.burst && clock_type::now() < deadline; ++i) {
+      api::ContestantAnswer answer;
+      answer.set_task_id(task_ids[pick_task(rng)]);
+      answer.set_answer(std::to_string(pick_answer(rng)));
+      answer.set_write_token(write_token);
+      auto response = client.call("/contestant/answer", &answer);
+      if (response.code() == api::OK) {
+        // Server may reissue the token, if the KIM has been changed
+        write_token = response.response();
+      }
+    }
+
+    if (opts.reload_every > 0 && bursts % opts.reload_every == 0) {
+      api::ContestantKim reloaded;
+      if (client.call("/contestant/tasks", nullptr, reloaded,
+                      tasks_query + "&tasks_etag=" + etag, "/contestant/tasks (tasks_etag)")) {
+        write_token = reloaded.write_token();
+        etag = reloaded.tasks_etag();
+      }
+      api::ContestantKimList unused;
+      client.call("/contestant/available-kims", nullptr, unused);
+    }
+
+    think(rng, opts.think_time, deadline);
+  }
+}
+
+void run_admin(options const& opts, int index, clock_type::time_point deadline, recorder& stats) {
+  std::mt19937 rng((unsigned) (1'000'000 + index));
+  api_client client(opts.endpoints, (std::size_t) index, opts.api_root, stats);
+  ramp_up(opts, rng);
+
+  if (!login(client, opts.admin_username, opts.admin_password)) {
+    stats.fail("admin login failed");
+    return;
+  }
+
+  api::KimListResponse kims;
+  api::GroupListResponse groups;
+  if (!client.call("/kim/list", nullptr, kims) || !client.call("/groups/list", nullptr, groups)) {
+    stats.fail("KIM or group list request failed");
+    return;
+  }
+  auto kim_it = std::ranges::find_if(
+      kims.kims(), [&](api::Kim const& kim) { return kim.name() == opts.kim_name; });
+  auto group_it = std::ranges::find_if(
+      groups.groups(), [&](api::Group const& group) { return group.name() == opts.group_name; });
+  if (kim_it == kims.kims().end() || group_it == groups.groups().end()) {
+    stats.fail("no KIM or group for standings");
+    return;
+  }
+
+  // The first request loads the whole board, the following ones only fetch new submissions
+  int64_t sync_tag = 0;
+  while (clock_type::now() < deadline) {
+    api::StandingsRequest request;
+    request.set_kim_id(kim_it->id());
+    request.set_group_id(group_it->id());
+    request.set_sync_tag(sync_tag);
+
+    api::StandingsResponse response;
+    if (client.call("/admin/standings", &request, response, "",
+                    sync_tag ? "/admin/standings (incremental)" : "/admin/standings (full)")) {
+      sync_tag = response.sync_tag();
+    }
+    think(rng, opts.standings_interval, deadline);
+  }
+}
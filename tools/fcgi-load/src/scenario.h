@@ -0,0 +1,42 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "fcgi-client.h"
+#include "stats.h"
+
+struct options {
+  std::vector<endpoint> endpoints;
+  string api_root = "/api";
+
+  // Contestants log in as <user_prefix><i> for i in [0, contestants).
+  int contestants = 50;
+  string user_prefix = "load-";
+  string password = "password";
+
+  int admins = 1;
+  string admin_username = "admin";
+  string admin_password = "password";
+
+  // Names of the KIM and the group to use, as created by `seed`.
+  string kim_name = "load-test";
+  string group_name = "load-test";
+
+  std::chrono::seconds duration{60};
+  std::chrono::seconds ramp_up{5};
+
+  // Every contestant submits `burst` answers in a row, then thinks for about `think_time`.
+  int burst = 5;
+  std::chrono::milliseconds think_time{2000};
+  // Every `reload_every` bursts a contestant reloads the page (tasks with tasks_etag, then
+  // available KIMs).
+  int reload_every = 5;
+
+  std::chrono::milliseconds standings_interval{2000};
+
+  bool json = false;
+};
+
+void run_contestant(options const& opts, int index, clock_type::time_point deadline,
+                    recorder& stats);
+void run_admin(options const& opts, int index, clock_type::time_point deadline, recorder& stats);
@@ -0,0 +1,89 @@
+#include "seed.h"
+
+namespace {
+// Salt and hash of the password "password", the same as for the default users in db.sql
+char const* const PASSWORD_SALT =
+    "a93c87f2f88b9aca33ba64fdb35bde919c0aadfd690507d9b2da38cb1a9ba4ff";
+char const* const PASSWORD_HASH =
+    "e1bdae5584062bf6a4472260180be513e1db4cfe334fec1c67cb5e5eb26452fa";
+
+// Task types with FULL_MATCH grading in db.sql
+const int FIRST_TASK_TYPE = 500000;
+const int TASK_TYPES = 25;
+
+string quote(std::string_view s) {
+  string result = "'";
+  for (char c : s) {
+    result += c;
+    if (c == '\'') {
+      result += c;
+    }
+  }
+  return result + "'";
+}
+}  // namespace
+
+void print_seed(options const& opts, int tasks) {
+  if (opts.password != "password") {
+    throw std::invalid_argument("seeded users always have the password \"password\"");
+  }
+
+  auto kim = quote(opts.kim_name), group = quote(opts.group_name);
+  auto prefix = quote(opts.user_prefix);
+
+  fmt::print("-- Generated by fcgi-load seed\n");
+  fmt::print("BEGIN;\n\n");
+
+  fmt::print(
+      "INSERT INTO users (username, display_name, permissions, salt, password)\n"
+      "  SELECT {0} || i, 'Load user ' || i, 0, '{1}', '{2}' FROM generate_series(0, {3}) i\n"
+      "  ON CONFLICT (username) DO NOTHING;\n\n",
+      prefix, PASSWORD_SALT, PASSWORD_HASH, opts.contestants - 1);
+
+  fmt::print(
+      "INSERT INTO groups (display_name)\n"
+      "  SELECT {0} WHERE NOT EXISTS (SELECT 1 FROM groups WHERE display_name = {0});\n\n",
+      group);
+
+  fmt::print(
+      "INSERT INTO users_groups (user_id, group_id)\n"
+      "  SELECT u.id, g.id FROM users u, (SELECT min(id) AS id FROM groups WHERE display_name = "
+      "{0}) g\n"
+      "  WHERE starts_with(u.username, {1}) AND NOT EXISTS (\n"
+      "    SELECT 1 FROM users_groups ug WHERE ug.user_id = u.id AND ug.group_id = g.id);\n\n",
+      group, prefix);
+
+  fmt::print(
+      "INSERT INTO kims (name, token_version, deleted)\n"
+      "  SELECT {0}, 0, false WHERE NOT EXISTS (SELECT 1 FROM kims WHERE name = {0} AND NOT "
+      "deleted);\n\n",
+      kim);
+
+  fmt::print(
+      "WITH kim AS (SELECT min(id) AS id FROM kims WHERE name = {0} AND NOT deleted),\n"
+      "new_tasks AS (\n"
+      "  INSERT INTO tasks (task_type, task, tag, answer_rows, answer_cols, answer, deleted)\n"
+      "  SELECT {1} + i % {2}, '<p>Load test task ' || i || '</p>', 'load-test', 1, 1,\n"
+      "         convert_to((i * 37 % 100)::text, 'UTF8'), false\n"
+      "  FROM generate_series(0, {3}) i, kim\n"
+      "  WHERE NOT EXISTS (SELECT 1 FROM kims_tasks WHERE kim_id = kim.id)\n"
+      "  RETURNING id\n"
+      ")\n"
+      "INSERT INTO kims_tasks (kim_id, task_id, pos)\n"
+      "  SELECT kim.id, new_tasks.id, (row_number() OVER (ORDER BY new_tasks.id))::integer - 1\n"
+      "  FROM kim, new_tasks;\n\n",
+      kim, FIRST_TASK_TYPE, TASK_TYPES, tasks - 1);
+
+  // The KIM is open for a month, so the seed can be reused for several runs
+  fmt::print(
+      "INSERT INTO groups_kims (group_id, kim_id, start_time, end_time, duration, virtual, exam)\n"
+      "  SELECT g.id, k.id, now() AT TIME ZONE 'UTC' - interval '1 hour',\n"
+      "         now() AT TIME ZONE 'UTC' + interval '30 days', 14100000, false, false\n"
+      "  FROM (SELECT min(id) AS id FROM groups WHERE display_name = {0}) g,\n"
+      "       (SELECT min(id) AS id FROM kims WHERE name = {1} AND NOT deleted) k\n"
+      "  ON CONFLICT (group_id, kim_id) DO UPDATE\n"
+      "  SET start_time = excluded.start_time, end_time = excluded.end_time;\n\n",
+      group, kim);
+
+  fmt::print("COMMIT;\n");
+}
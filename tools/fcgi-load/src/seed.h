@@ -0,0 +1,9 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "scenario.h"
+
+// Prints SQL which creates contestants, a group and an ongoing KIM for the load test. The script
+// can be applied several times, it only adds what is missing.
+void print_seed(options const& opts, int tasks);
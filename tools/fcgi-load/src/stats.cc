@@ -0,0 +1,100 @@
+#include "stats.h"
+
+namespace {
+double percentile(std::vector<double> const& sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  auto pos = (std::size_t) (p * double(sorted.size() - 1) + 0.5);
+  return sorted[std::min(pos, sorted.size() - 1)];
+}
+
+struct summary {
+  string route;
+  std::size_t requests;
+  int64_t errors;
+  double rps, p50, p90, p99, max;
+};
+
+summary summarize(string const& route, route_stats const& stats, double elapsed) {
+  auto sorted = stats.latencies;
+  std::sort(sorted.begin(), sorted.end());
+  return {
+      .route = route,
+      .requests = sorted.size(),
+      .errors = stats.errors,
+      .rps = elapsed > 0 ? double(sorted.size()) / elapsed : 0,
+      .p50 = percentile(sorted, 0.5),
+      .p90 = percentile(sorted, 0.9),
+      .p99 = percentile(sorted, 0.99),
+      .max = sorted.empty() ? 0 : sorted.back(),
+  };
+}
+}  // namespace
+
+void recorder::add(string const& route, clock_type::duration latency, bool ok) {
+  auto& stats = routes[route];
+  stats.latencies.push_back(std::chrono::duration<double, std::milli>(latency).count());
+  if (!ok) {
+    ++stats.errors;
+  }
+}
+
+void recorder::fail(string const& reason) {
+  ++failures[reason];
+}
+
+void recorder::merge(recorder const& other) {
+  for (auto const& [reason, count] : other.failures) {
+    failures[reason] += count;
+  }
+  for (auto const& [route, stats] : other.routes) {
+    auto& into = routes[route];
+    into.latencies.insert(into.latencies.end(), stats.latencies.begin(), stats.latencies.end());
+    into.errors += stats.errors;
+  }
+}
+
+void recorder::report(double elapsed, bool as_json) const {
+  std::vector<summary> rows;
+  route_stats total;
+  for (auto const& [route, stats] : routes) {
+    rows.push_back(summarize(route, stats, elapsed));
+    total.latencies.insert(total.latencies.end(), stats.latencies.begin(), stats.latencies.end());
+    total.errors += stats.errors;
+  }
+  rows.push_back(summarize("total", total, elapsed));
+
+  if (as_json) {
+    fmt::print("{{\n  \"elapsed_seconds\": {:.3f},\n  \"routes\": [\n", elapsed);
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+      auto const& r = rows[i];
+      fmt::print(
+          "    {{\"route\": \"{}\", \"requests\": {}, \"errors\": {}, \"rps\": {:.2f}, "
+          "\"p50_ms\": {:.3f}, \"p90_ms\": {:.3f}, \"p99_ms\": {:.3f}, \"max_ms\": {:.3f}}}{}\n",
+          r.route, r.requests, r.errors, r.rps, r.p50, r.p90, r.p99, r.max,
+          i + 1 == rows.size() ? "" : ",");
+    }
+    fmt::print("  ],\n  \"failures\": {{");
+    for (auto it = failures.begin(); it != failures.end(); ++it) {
+      fmt::print("{}\"{}\": {}", it == failures.begin() ? "" : ", ", it->first, it->second);
+    }
+    fmt::print("}}\n}}\n");
+    return;
+  }
+
+  fmt::print("Elapsed: {:.1f} s\n\n", elapsed);
+  fmt::print("{:<38} {:>9} {:>7} {:>9} {:>9} {:>9} {:>9} {:>9}\n", "route", "requests", "errors",
+             "rps", "p50, ms", "p90, ms", "p99, ms", "max, ms");
+  for (auto const& r : rows) {
+    fmt::print("{:<38} {:>9} {:>7} {:>9.1f} {:>9.2f} {:>9.2f} {:>9.2f} {:>9.2f}\n", r.route,
+               r.requests, r.errors, r.rps, r.p50, r.p90, r.p99, r.max);
+  }
+
+  if (failures.size()) {
+    fmt::print("\nUsers which gave up:\n");
+    for (auto const& [reason, count] : failures) {
+      fmt::print("  {}: {}\n", reason, count);
+    }
+  }
+}
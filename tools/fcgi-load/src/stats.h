@@ -0,0 +1,26 @@
+#pragma once
+
+#include "stdafx.h"
+
+struct route_stats {
+  // In milliseconds
+  std::vector<double> latencies;
+  int64_t errors = 0;
+};
+
+// Latencies of requests grouped by route. Every virtual user has its own recorder, they are
+// merged once the run is over, so recording does not need any synchronization.
+class recorder {
+private:
+  std::map<string, route_stats> routes;
+  // Virtual users which gave up before generating any load, by reason
+  std::map<string, int64_t> failures;
+
+public:
+  void add(string const& route, clock_type::duration latency, bool ok);
+  void fail(string const& reason);
+  void merge(recorder const& other);
+
+  // Prints a table (or a JSON document) with throughput and latency percentiles of every route.
+  void report(double elapsed_seconds, bool as_json) const;
+};
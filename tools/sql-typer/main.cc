@@ -4,6 +4,7 @@
 #include <libpq-fe.h>
 
 #include <algorithm>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -55,6 +56,9 @@ struct sql_statement {
   int lineno;
   std::string name;
   std::set<std::string> nullable_fields;
+  // Statement may be routed to a read replica. Replicas reject writes, so a mislabeled statement
+  // fails loudly instead of silently losing data.
+  bool read_only = false;
 
   std::string sql_command;
 };
@@ -118,7 +122,9 @@ int main(int argc, char **argv) {
         }
 
         const static std::string NULLABLE_START = "--  nullable ";
-        if (!line.starts_with(NULLABLE_START)) {
+        if (line == "--  read-only") {
+          statements.back().read_only = true;
+        } else if (!line.starts_with(NULLABLE_START)) {
           issue_error("unknown statement specification");
         } else {
           statements.back().nullable_fields.emplace(line.substr(NULLABLE_START.size()));
@@ -149,6 +155,10 @@ int main(int argc, char **argv) {
 
 )";
 
+  // Statement names are used for server-side prepared statements, so they have to be unique
+  // across all files of a project.
+  auto name_prefix = std::filesystem::path(argv[2]).stem().string();
+
   for (auto &stmt : statements) {
     lineno = stmt.lineno;
 
@@ -228,14 +238,15 @@ int main(int argc, char **argv) {
 const async::pq::prepared_sql_query<
   async::pq::type_sequence<{}>,
   async::pq::type_sequence<{}>
-> {}_QUERY{{R"BoRdEr({})BoRdEr"}};
+> {}_QUERY{{R"BoRdEr({})BoRdEr", "{}/{}", {}}};
 }}
 
 #define {}_REQUEST {}
 
 )EOF",
                        fmt::join(input_type_seq, ", "), fmt::join(output_type_seq, ", "), stmt.name,
-                       command, stmt.name, fmt::join(args, ", "));
+                       command, name_prefix, stmt.name, stmt.read_only, stmt.name,
+                       fmt::join(args, ", "));
       }
     }
   }
@@ -22,6 +22,9 @@ type TaskSettings = Task & {
   pos: number;
 };
 
+// Tasks of recently opened KIMs, so they are not downloaded again if unchanged
+const cachedTasks = new Map<string, { etag: string; tasks: Task[] }>();
+
 const textDecoder = new TextDecoder();
 const textEncoder = new TextEncoder();
 
@@ -275,7 +278,24 @@ class KimSolvePage extends Page {
     this.unloadable = !!userInfo!.perms;
 
     const taskTypes = await getTaskTypes();
-    this.kim = await requestU(ContestantKim, "/api/contestant/tasks?id=" + this.params.get("id")!);
+    const kimId = this.params.get("id")!;
+    const cached = cachedTasks.get(kimId);
+    this.kim = await requestU(
+      ContestantKim,
+      "/api/contestant/tasks?id=" + kimId + (cached ? "&tasks_etag=" + cached.etag : "")
+    );
+    if (cached && cached.etag === this.kim.getTasksEtag()) {
+      // Server sent only answers
+      this.kim.setTasksList(
+        this.kim
+          .getTasksList()
+          .map((task, i) => cached.tasks[i].clone().setAnswer(task.getAnswer_asU8()))
+      );
+    }
+    cachedTasks.set(kimId, {
+      etag: this.kim.getTasksEtag(),
+      tasks: this.kim.getTasksList().map((task) => task.clone()),
+    });
     this.writeToken = this.kim.getWriteToken_asU8();
 
     for (const [index, task] of this.kim.getTasksList().entries()) {